@@ -0,0 +1,79 @@
+#!/usr/bin/env python
+
+# Copyright (C) 2018  István Bozsó
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+from argparse import ArgumentParser
+
+from inmet.satorbit import Satorbit
+
+def main():
+    
+    ap = ArgumentParser(description="Azimuth and incidence angles (or other "
+                        "geometry outputs) of the points of a raw binary "
+                        "file, computed chunk by chunk.")
+    
+    ap.add_argument("fit_file", help="Orbit polynom saved by fit_orbit.py.")
+    ap.add_argument("in_path", help="Raw binary file of (lon, lat, h) or, "
+                    "with --xyz, (X, Y, Z) rows.")
+    ap.add_argument("out_path", help="Raw binary file of the results.")
+    
+    ap.add_argument("--xyz", action="store_true",
+                    help="Input rows are WGS-84 Cartesian coordinates.")
+    ap.add_argument("--float32_in", action="store_true",
+                    help="Input is float32 instead of float64.")
+    ap.add_argument("--float32_out", action="store_true",
+                    help="Output is float32 instead of float64.")
+    ap.add_argument("--output", default="angles",
+                    choices=("angles", "los", "los_range", "angles_range",
+                             "radar"), help="Quantities computed per point.")
+    ap.add_argument("--solver", default="bisect",
+                    choices=("bisect", "newton", "halley"),
+                    help="Zero-Doppler time search.")
+    ap.add_argument("--warm_start", default="off",
+                    choices=("off", "sorted", "sort"),
+                    help="Seed the search from the previous point.")
+    ap.add_argument("--max_iter", type=int, default=1000,
+                    help="Iteration limit of the search.")
+    ap.add_argument("--nthreads", type=int, default=1,
+                    help="Worker threads, 0 means one per processor.")
+    ap.add_argument("--fast_math", action="store_true",
+                    help="Polynomial sin, cos, acos and atan.")
+    ap.add_argument("--chunk_rows", type=int, default=1 << 20,
+                    help="Points mapped into memory at a time.")
+    ap.add_argument("--quiet", action="store_true",
+                    help="Do not report progress.")
+    
+    args = ap.parse_args()
+    
+    sat = Satorbit(args.fit_file, "fit_file")
+    
+    nrows, elapsed = \
+    sat.azi_inc_file(args.in_path, args.out_path, is_lonlat=not args.xyz,
+                     max_iter=args.max_iter, solver=args.solver,
+                     warm_start=args.warm_start, nthreads=args.nthreads,
+                     fast_math=args.fast_math, output=args.output,
+                     float32_in=args.float32_in,
+                     float32_out=args.float32_out,
+                     chunk_rows=args.chunk_rows,
+                     progress=None if args.quiet else True)
+    
+    if not args.quiet:
+        print("{} points in {:.2f} s".format(nrows, elapsed))
+    
+    return 0
+
+if __name__ == "__main__":
+    main()
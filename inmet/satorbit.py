@@ -15,6 +15,7 @@
 
 from __future__ import print_function
 
+import sys
 import numpy as np
 from os.path import isfile
 import pickle as pk
@@ -23,7 +24,15 @@ from gnuplot import Gnuplot, linedef
 from inmet.utils import get_par
 import inmet.inmet_aux as ina
 
-__all__ = ("Satorbit")
+__all__ = ("Satorbit", "azi_inc_multi", "azi_inc_dates", "ell_cart",
+           "cart_ell")
+
+_solvers = {"bisect": 0, "newton": 1, "halley": 2}
+_warm_starts = {"off": 0, "sorted": 1, "sort": 2}
+_bases = {"power": 0, "chebyshev": 1}
+_cart_ell_methods = {"bowring": 0, "fast": 1, "exact": 2}
+_outputs = {"angles": 0, "los": 1, "los_range": 2, "angles_range": 3,
+            "radar": 4}
 
 class Satorbit(object):
     def __init__(self, path, mode):
@@ -96,6 +105,7 @@ class Satorbit(object):
         
         self.centered = int(poly["centered"])
         self.deg = int(poly["deg"])
+        self.basis = poly.get("basis", "power")
         
         if self.centered:
             self.mean_coords = np.genfromtxt(poly["mean_coords"].split(),
@@ -109,19 +119,29 @@ class Satorbit(object):
         self.t_stop  = float(poly["t_stop"])
         
         self.coeffs = np.genfromtxt(poly["coefficients"].split(),
-                                    dtype=np.double).reshape(3, deg + 1)
+                                    dtype=np.double).reshape(3, self.deg + 1)
 
     
-    def fit_orbit(self, centered=True, deg=3):
+    def fit_orbit(self, centered=True, deg=3, basis="power"):
+        """
+        basis: "power" (polynom of time) or "chebyshev" (Chebyshev series
+        of time scaled from [t_start, t_stop] to [-1, 1], better conditioned
+        for high degrees).
+        """
         
         time, coords = self.time, self.coords
         
         self.centered = centered
         self.deg = deg
+        self.basis = basis
         
         self.t_start = np.min(time)
         self.t_stop  = np.max(time)
         
+        if basis == "chebyshev":
+            scaled = (2.0 * time - (self.t_start + self.t_stop)) \
+                     / (self.t_stop - self.t_start)
+        
         if centered:
             mean_t = np.mean(time)
             mean_coords = np.mean(coords, axis=0)
@@ -132,7 +152,11 @@ class Satorbit(object):
             to_fit = coords
             cent = "centered:\t0\n"
         
-        design = np.vander(time, deg + 1)
+        if basis == "chebyshev":
+            # coefficients from lowest to highest order
+            design = np.polynomial.chebyshev.chebvander(scaled, deg)
+        else:
+            design = np.vander(time, deg + 1)
         
         # coeffs[0]: polynom coeffcients are in the columns
         # coeffs[1]: residuals
@@ -157,6 +181,7 @@ class Satorbit(object):
             f.write("t_stop:\t{}\n".format(self.t_stop))
             f.write("Degree of fitted polynom.\n")
             f.write("deg:\t{}\n".format(self.deg))
+            f.write("basis:\t{}\n".format(self.basis))
             
             f.write("(x, y, z) residuals: ({})\n"
                     .format(", ".join(str(elem) for elem in coeffs[1].astype(str))))
@@ -173,11 +198,147 @@ class Satorbit(object):
                         .format(" ".join(str(coord) for coord in self.mean_coords)))
         
 
-    def azi_inc(fit_file, coords, is_lonlat=True, max_iter=1000):
-        
-        return ina.azi_inc(self.t_start, self.t_stop, self.t_mean,
-                           self.mean_coords, self.centered, self.coeffs,
-                           self.deg, max_iter, is_lonlat, coords)
+    def orbit(self):
+        """
+        The fitted polynom as an inmet_aux.Orbit. The coefficients are
+        copied once, its azi_inc, zero_doppler, position and velocity
+        methods can then be called for every tile without setting up the
+        polynom again. Orbit.azi_inc takes the options of Satorbit.azi_inc
+        as integers (solver, warm_start, output), see _solvers,
+        _warm_starts and _outputs.
+        """
+        
+        return ina.Orbit(self.t_mean, self.t_start, self.t_stop,
+                         self.centered, self.deg, self.mean_coords,
+                         self.coeffs, basis=_bases[self.basis])
+    
+    def azi_inc(self, coords, is_lonlat=True, max_iter=1000, solver="bisect",
+                return_niter=False, warm_start="off", nthreads=1,
+                lut_step=None, fast_math=False, output="angles", sar=None,
+                float32=False, out=None):
+        """
+        solver: zero-Doppler time search, "bisect", "newton" or "halley".
+        If return_niter is True the number of iterations per point is
+        also returned.
+        warm_start: "off", "sorted" (coords are sorted along-track) or
+        "sort" (sort coords along-track internally). The search of every
+        point starts from the zero-Doppler time of its predecessor.
+        nthreads: number of worker threads, 0 means one per processor.
+        lut_step: (dlon [deg], dlat [deg], dh [m]) spacing of a lookup table
+        that is solved exactly and interpolated for every point. If given,
+        the largest (azimuth, incidence) interpolation error found at the
+        centers of the table cells is also returned.
+        fast_math: polynomial sin, cos, acos and atan instead of libm,
+        vectorized. The angles change by less than 1e-10 rad.
+        output: "angles" returns (azimuth, incidence) [deg] per point,
+        "angles_range" also the slant range [m], "los" the (east, north, up)
+        unit vector pointing from the point to the satellite, "los_range"
+        the same and the slant range, "radar" the zero-Doppler time [s],
+        the slant range [m], the satellite position [m] and velocity [m/s].
+        sar: (t_first [s], prf [Hz], near_range [m], range sampling rate
+        [Hz]) of an image, with output="radar" the (line, pixel)
+        coordinates of the points are also returned.
+        float32: results as float32 arrays, not available with
+        output="radar". float32 coords are always accepted as they are,
+        the geometry is computed in double. Aligned float64 or float32 coords
+        are read in place, whatever their strides.
+        out: writeable float64 or float32 (n, ncols) array that receives the
+        results instead of a new array, it may be a strided view.
+        """
+        
+        kwargs = {}
+        
+        if lut_step is not None:
+            kwargs["lut_step"] = tuple(lut_step)
+        
+        if sar is not None:
+            kwargs["sar"] = tuple(sar)
+        
+        return ina.azi_inc(self.t_mean, self.t_start, self.t_stop,
+                           self.centered, self.deg, self.mean_coords,
+                           self.coeffs, coords, is_lonlat, max_iter,
+                           solver=_solvers[solver], return_niter=return_niter,
+                           warm_start=_warm_starts[warm_start],
+                           nthreads=nthreads,
+                           basis=_bases[self.basis], fast_math=fast_math,
+                           output=_outputs[output], float32=float32,
+                           out=out, **kwargs)
+    
+    def azi_inc_file(self, in_path, out_path, is_lonlat=True, max_iter=1000,
+                     solver="bisect", warm_start="off", nthreads=1,
+                     fast_math=False, output="angles", float32_in=False,
+                     float32_out=False, chunk_rows=1 << 20, progress=None):
+        """
+        Satorbit.azi_inc of the points of a file too large for memory.
+        in_path: raw binary file of (n, 3) coordinate rows, float64 or, with
+        float32_in, float32 in native byte order.
+        out_path: raw binary file created for the (n, ncols) result rows,
+        float64 or, with float32_out, float32.
+        Both files are memory mapped chunk_rows rows at a time (rounded up
+        to a multiple of 4096), the results are the same as those of
+        azi_inc on the whole array (except with warm_start="sort").
+        progress: None, True (progress and throughput on stderr) or a
+        function called with (rows done, total rows, seconds elapsed)
+        after every chunk.
+        Returns the number of points and the seconds elapsed.
+        """
+        
+        if progress is True:
+            progress = print_progress
+        
+        return ina.azi_inc_file(self.t_mean, self.t_start, self.t_stop,
+                                self.centered, self.deg, self.mean_coords,
+                                self.coeffs, in_path, out_path, is_lonlat,
+                                max_iter, solver=_solvers[solver],
+                                warm_start=_warm_starts[warm_start],
+                                nthreads=nthreads, basis=_bases[self.basis],
+                                fast_math=fast_math, output=_outputs[output],
+                                float32_in=float32_in,
+                                float32_out=float32_out,
+                                chunk_rows=chunk_rows, progress=progress)
+
+    def geocode(self, sar, radar=None, shape=None, first=(0.0, 0.0),
+                step=(1.0, 1.0), is_line_pixel=True, dem=None, dem_geo=None,
+                h0=0.0, look="right", max_iter=20, tol=1e-3, nthreads=1):
+        """
+        Forward geocoding, the (lon [deg], lat [deg], h [m]) of the ground
+        points seen in radar coordinates.
+        sar: (t_first [s], prf [Hz], near_range [m], range sampling rate
+        [Hz]) of the image.
+        radar: (n, 2) array of (line, pixel) or, if is_line_pixel is False,
+        (zero-Doppler time [s], slant range [m]) rows, an (n, 3) array is
+        returned.
+        shape: (nrow, ncol) of a raster to geocode instead of radar, the
+        pixel in row i, column j is at line first[0] + i * step[0], pixel
+        first[1] + j * step[1]. An (nrow, ncol, 3) array is returned.
+        dem: 2D array of heights [m] on a lon/lat grid, dem_geo is
+        (lon, lat of the center of dem[0,0] [deg], dlon, dlat [deg]).
+        Without a DEM the constant height h0 is used.
+        look: "right" or "left" looking radar.
+        Pixels outside of the DEM or without convergence (tol [m] height
+        misfit within max_iter height updates) are NaN.
+        """
+        
+        kwargs = {}
+        
+        if radar is not None:
+            kwargs["radar"] = radar
+        
+        if shape is not None:
+            kwargs["shape"] = tuple(shape)
+        
+        if dem is not None:
+            kwargs["dem"] = dem
+            kwargs["dem_geo"] = tuple(dem_geo)
+        
+        return ina.geocode(self.t_mean, self.t_start, self.t_stop,
+                           self.centered, self.deg, self.mean_coords,
+                           self.coeffs, tuple(sar),
+                           raster=tuple(first) + tuple(step),
+                           is_line_pixel=is_line_pixel, h0=h0,
+                           look_right=look == "right", max_iter=max_iter,
+                           tol=tol, nthreads=nthreads,
+                           basis=_bases[self.basis], **kwargs)
 
     def plot_orbit(self, plotfile, nsamp=100):
         
@@ -230,6 +391,110 @@ class Satorbit(object):
             gpt.plot(points, fit)
 
 
+def azi_inc_multi(orbits, coords, is_lonlat=True, max_iter=1000,
+                  solver="bisect", warm_start="off", nthreads=1,
+                  fast_math=False, output="angles", master=None):
+    """
+    Satorbit.azi_inc of coords for every Satorbit of orbits in one call,
+    returns an (n_points, n_orbits, 2) array (3 or 4 columns for the "los",
+    "angles_range" and "los_range" outputs). The orbits should have the
+    same degree and basis. With warm_start="sort" points are sorted along
+    the track of the first orbit (of the master orbit if given).
+    master: index of an orbit, its zero-Doppler times seed the search of
+    all other orbits.
+    """
+    
+    degs = set(orb.deg for orb in orbits)
+    bases = set(orb.basis for orb in orbits)
+    
+    if len(degs) != 1 or len(bases) != 1:
+        raise ValueError("Orbits should have the same degree and basis.")
+    
+    # uncentered orbits are centered on zero
+    mean_t = [orb.t_mean if orb.centered else 0.0 for orb in orbits]
+    mean_coords = [orb.mean_coords if orb.centered else np.zeros(3)
+                   for orb in orbits]
+    
+    return ina.azi_inc_multi(np.asarray(mean_t, dtype=np.double),
+                             np.asarray([orb.t_start for orb in orbits],
+                                        dtype=np.double),
+                             np.asarray([orb.t_stop for orb in orbits],
+                                        dtype=np.double),
+                             True, degs.pop(),
+                             np.asarray(mean_coords, dtype=np.double),
+                             np.asarray([orb.coeffs for orb in orbits],
+                                        dtype=np.double),
+                             coords, is_lonlat, max_iter,
+                             solver=_solvers[solver],
+                             warm_start=_warm_starts[warm_start],
+                             nthreads=nthreads, basis=_bases[bases.pop()],
+                             fast_math=fast_math, output=_outputs[output],
+                             master=-1 if master is None else master)
+
+
+def azi_inc_dates(orbits, coords, master=0, is_lonlat=True, max_iter=1000,
+                  solver="bisect", warm_start="off", nthreads=1,
+                  fast_math=False):
+    """
+    Geometry of a time series, orbits holds the Satorbit of every date.
+    Returns the azimuth, incidence angle [deg] and slant range [m] arrays,
+    all of shape (n_points, n_dates). The points are solved for the master
+    date first, their zero-Doppler times then seed the search of the other
+    dates.
+    """
+    
+    cube = azi_inc_multi(orbits, coords, is_lonlat, max_iter, solver,
+                         warm_start, nthreads, fast_math, "angles_range",
+                         master)
+    
+    return cube[:,:,0], cube[:,:,1], cube[:,:,2]
+
+
+def ell_cart(coords, out=None, is_deg=True, nthreads=1, fast_math=False):
+    """
+    WGS-84 Cartesian coordinates of the (lon, lat, h) rows of coords.
+    out: (n, 3) double array receiving the result, it can be coords itself.
+    fast_math: polynomial sin and cos instead of libm, vectorized, the
+    error stays below 2e-7 m.
+    """
+    return ina.ell_to_cart(coords, out=out, is_deg=is_deg, nthreads=nthreads,
+                           fast_math=fast_math)
+
+
+def cart_ell(coords, out=None, is_deg=True, method="bowring", nthreads=1):
+    """
+    Geodetic (lon, lat, h) coordinates of the (X, Y, Z) rows of coords,
+    lon is in (-180, 180].
+    out: (n, 3) double array receiving the result, it can be coords itself.
+    method: "bowring" (Bowring's formula, one iteration), "fast" (the same
+    without trigonometric functions, vectorized) or "exact" (closed form of
+    Vermeille). Largest errors, -500 m < h < 9 km (h < 1000 km):
+    bowring: latitude 2.3e-12 rad (9e-10 rad), height 1.4e-5 m (8e-3 m)
+    fast: latitude 2.3e-12 rad (9e-10 rad), height 5e-9 m
+    exact: latitude 5e-16 rad, height 5e-9 m
+    "fast" is about twice as fast as the other two.
+    """
+    return ina.cart_to_ell(coords, out=out, is_deg=is_deg,
+                           method=_cart_ell_methods[method],
+                           nthreads=nthreads)
+
+
+def print_progress(done, total, elapsed):
+    """
+    Progress report of Satorbit.azi_inc_file on stderr.
+    """
+    
+    rate = done / elapsed if elapsed > 0.0 else 0.0
+    
+    sys.stderr.write("\r{} / {} points ({:.1f} %), {:.0f} points/s"
+                     .format(done, total, 100.0 * done / total, rate))
+    
+    if done == total:
+        sys.stderr.write("\n")
+    
+    sys.stderr.flush()
+
+
 def str2orbit(line):
     line_split = line.split()
     
@@ -17,7 +17,8 @@ from argparse import ArgumentParser
 from subprocess import check_output, CalledProcessError
 from shlex import split
 from logging import getLogger
-from inmet.inmet_aux import ell_to_merc_full, ell_to_merc_fast 
+import numpy as np
+from inmet.inmet_aux import ell_to_merc
 
 log = getLogger("inmet.utils")
 
@@ -25,17 +26,25 @@ ellipsoids = {
     "mercator": (6378137.0, 8.1819190903e-2)
 }
 
-def ell2merc(lon, lat, isdeg=True, ellipsoid="mercator", lon0=None, fast=False):
+def ell2merc(lon, lat, isdeg=True, ellipsoid="mercator", lon0=None, fast=False,
+             fast_math=False, float32=False, out=None):
+    """
+    fast: spherical instead of ellipsoidal Mercator projection.
+    fast_math: polynomial sin and atanh instead of libm, relative error of
+    y is below 1e-11.
+    float32: return a float32 array. float32 lon and lat are always
+    accepted without conversion, the projection is computed in double.
+    out: writeable float64 or float32 (n, 2) array that receives x, y
+    instead of a new array.
+    """
     
     if lon0 is None:
         lon0 = np.mean(lon)
     
     ell = ellipsoids[ellipsoid]
     
-    if fast:
-        return ell_to_merc_fast(lon, lat, lon0, ell[0], ell[1], isdeg), lon0
-    else:
-        return ell_to_merc_full(lon, lat, lon0, ell[0], ell[1], isdeg), lon0
+    return ell_to_merc(lon, lat, lon0, ell[0], ell[1], isdeg, fast,
+                       fast_math, float32, out), lon0
 
 
 def _make_cmd(command):
@@ -1,5 +1,10 @@
 #include "nparray.hh"
 
+// numpy < 2.0
+#if NPY_ABI_VERSION < 0x02000000
+#define PyDataType_ELSIZE(descr) ((descr)->elsize)
+#endif
+
 #define handle_shape \
 npy_intp *_shape;\
 \
@@ -25,7 +30,7 @@ static bool setup_array(nparray *arr, PyArrayObject *_array, size_t const edim)
         
     }
     
-    int elemsize = int(PyArray_ITEMSIZE(_array));
+    npy_intp elemsize = PyArray_ITEMSIZE(_array);
     
     size_t *tmp = new size_t[2 * _ndim];
     
@@ -36,11 +41,13 @@ static bool setup_array(nparray *arr, PyArrayObject *_array, size_t const edim)
     
     arr->strides = tmp;
     arr->shape = tmp + _ndim;
+    arr->ndim = _ndim;
+    arr->typenum = PyArray_TYPE(_array);
     
     npy_intp * strides = PyArray_STRIDES(_array);
     
     for(size_t ii = _ndim; ii--; )
-        arr->strides[ii] = size_t(double(strides[ii]) / elemsize);
+        arr->strides[ii] = size_t(strides[ii] / elemsize);
 
  
     npy_intp *shape = PyArray_DIMS(_array);
@@ -53,21 +60,80 @@ static bool setup_array(nparray *arr, PyArrayObject *_array, size_t const edim)
 }
 
 
+// view takes non-negative strides in units of elements
+static bool elem_strides(PyArrayObject *_array)
+{
+    npy_intp const elemsize = PyArray_ITEMSIZE(_array),
+                   *strides = PyArray_STRIDES(_array);
+    
+    for(int ii = PyArray_NDIM(_array); ii--; ) {
+        if (strides[ii] < 0 or strides[ii] % elemsize)
+            return false;
+    }
+    
+    return true;
+}
+
+
 bool nparray::import(int const typenum, size_t const ndim, PyObject *obj)
 {
     if (obj != NULL)
         pyobj = obj;
     
+    // aligned arrays of typenum are used as they are, strided or not
     if ((npobj = (PyArrayObject*) PyArray_FROM_OTF(pyobj, typenum,
-                                           NPY_ARRAY_IN_ARRAY)) == NULL) {
+                                           NPY_ARRAY_ALIGNED)) == NULL) {
         PyErr_Format(PyExc_TypeError, "Failed to convert numpy nparray!");
         return true;
     }
     
+    decref = true;
+    
+    if (not elem_strides(npobj)) {
+        PyArrayObject *copy = (PyArrayObject*) PyArray_NewCopy(npobj,
+                                                               NPY_CORDER);
+        Py_DECREF(npobj);
+        
+        if ((npobj = copy) == NULL) {
+            decref = false;
+            return true;
+        }
+    }
+    
     return setup_array(this, npobj, ndim);
 }
 
 
+bool nparray::import_out(int const typenum, size_t const ndim, PyObject *obj)
+{
+    if (obj != NULL)
+        pyobj = obj;
+    
+    // results are written directly into the array, no copies
+    if (not PyArray_Check(pyobj)
+        or PyArray_TYPE((PyArrayObject*) pyobj) != typenum
+        or not PyArray_ISWRITEABLE((PyArrayObject*) pyobj)
+        or not PyArray_ISALIGNED((PyArrayObject*) pyobj)
+        or not elem_strides((PyArrayObject*) pyobj)) {
+        PyErr_Format(PyExc_TypeError, "Output should be a writeable, aligned "
+                     "numpy array of the expected type with non-negative "
+                     "strides!");
+        return true;
+    }
+    
+    npobj = (PyArrayObject*) pyobj;
+    Py_INCREF(npobj);
+    
+    if (setup_array(this, npobj, ndim)) {
+        Py_DECREF(npobj);
+        npobj = NULL;
+        return true;
+    }
+    
+    return false;
+}
+
+
 bool nparray::from_data(int const typenum, void *data, size_t num, ...)
 {
     handle_shape;
@@ -85,6 +151,70 @@ bool nparray::from_data(int const typenum, void *data, size_t num, ...)
 }
 
 
+static char const* array_capsule = "inmet_aux.array";
+
+static void free_capsule(PyObject *capsule)
+{
+    array_free(PyCapsule_GetPointer(capsule, array_capsule));
+}
+
+
+bool nparray::adopt_strided(int const typenum, void *data, size_t const ndim,
+                            size_t const* shape, size_t const* strides)
+{
+    PyObject *base;
+    npy_intp *_shape, *_strides;
+    
+    // owns data from here on, also if the array cannot be created
+    if ((base = PyCapsule_New(data, array_capsule, free_capsule)) == NULL) {
+        array_free(data);
+        return true;
+    }
+    
+    if ((_shape = new npy_intp[2 * ndim]) == NULL) {
+        Py_DECREF(base);
+        PyErr_NoMemory();
+        return true;
+    }
+    
+    _strides = _shape + ndim;
+    
+    PyArray_Descr *descr = PyArray_DescrFromType(typenum);
+    
+    if (descr == NULL) {
+        delete[] _shape;
+        Py_DECREF(base);
+        return true;
+    }
+    
+    for(size_t ii = 0; ii < ndim; ++ii) {
+        _shape[ii] = npy_intp(shape[ii]);
+        _strides[ii] = npy_intp(strides[ii]) * PyDataType_ELSIZE(descr);
+    }
+    
+    // steals the reference to descr
+    npobj = (PyArrayObject*) PyArray_NewFromDescr(&PyArray_Type, descr,
+                int(ndim), _shape, _strides, data, NPY_ARRAY_ALIGNED
+                                                   | NPY_ARRAY_WRITEABLE,
+                NULL);
+    delete[] _shape;
+    
+    if (npobj == NULL) {
+        PyErr_Format(PyExc_TypeError, "Failed to create numpy nparray!");
+        Py_DECREF(base);
+        return true;
+    }
+    
+    // steals the reference to base, even on failure
+    if (PyArray_SetBaseObject(npobj, base) < 0) {
+        Py_CLEAR(npobj);
+        return true;
+    }
+    
+    return setup_array(this, npobj, 0);
+}
+
+
 bool nparray::empty(int const typenum, int const fortran, size_t num, ...)
 {
     handle_shape;
@@ -92,11 +222,11 @@ bool nparray::empty(int const typenum, int const fortran, size_t num, ...)
     if ((npobj = (PyArrayObject*) PyArray_EMPTY(num, _shape,
                       typenum, fortran)) == NULL) {
         PyErr_Format(PyExc_TypeError, "Failed to create numpy nparray!");
-        delete[] shape;
+        delete[] _shape;
         return true;
     }
     
-    delete[] shape;
+    delete[] _shape;
     return setup_array(this, npobj, 0);
 }
 
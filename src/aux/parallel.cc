@@ -0,0 +1,84 @@
+/* Copyright (C) 2018  István Bozsó
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "parallel.hh"
+
+
+struct work_range {
+    work_fun fun;
+    void *ctx;
+    size_t begin, end;
+};
+
+
+static void * run_range(void *arg)
+{
+    work_range const *wr = (work_range const*) arg;
+    wr->fun(wr->ctx, wr->begin, wr->end);
+    return NULL;
+}
+
+
+size_t num_cpus()
+{
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    return ncpu > 0 ? size_t(ncpu) : 1;
+}
+
+
+void parallel_for(size_t const num, size_t nthreads, work_fun fun, void *ctx)
+{
+    if (nthreads == 0)
+        nthreads = num_cpus();
+    
+    if (nthreads > max_threads)
+        nthreads = max_threads;
+    
+    if (nthreads > num)
+        nthreads = num;
+    
+    if (nthreads <= 1) {
+        fun(ctx, 0, num);
+        return;
+    }
+    
+    pthread_t threads[max_threads];
+    work_range ranges[max_threads];
+    bool started[max_threads];
+    
+    for(size_t ii = 0; ii < nthreads; ++ii) {
+        ranges[ii].fun = fun;
+        ranges[ii].ctx = ctx;
+        ranges[ii].begin = num * ii / nthreads;
+        ranges[ii].end = num * (ii + 1) / nthreads;
+    }
+    
+    for(size_t ii = 1; ii < nthreads; ++ii)
+        started[ii] = not pthread_create(&threads[ii], NULL, run_range,
+                                         &ranges[ii]);
+    
+    run_range(&ranges[0]);
+    
+    for(size_t ii = 1; ii < nthreads; ++ii) {
+        if (started[ii])
+            pthread_join(threads[ii], NULL);
+        else
+            run_range(&ranges[ii]);
+    }
+}
@@ -15,9 +15,13 @@
  */
 
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
-#include "nparray.hh"
 #include "satorbit.hh"
+#include "simd.hh"
+#include "fastmath.hh"
+#include "parallel.hh"
 
 
 static inline double norm(cdouble x, cdouble y, cdouble z)
@@ -25,137 +29,413 @@ static inline double norm(cdouble x, cdouble y, cdouble z)
     return sqrt(x * x + y * y + z * z);
 }
 
+
+/* Orbit polynoms.
+ *
+ * The zero-Doppler search evaluates the orbit polynom dozens of times per
+ * point, so its degree is resolved once per call (see orbit_dispatch) instead
+ * of once per evaluation. poly_orbit<deg> for deg = 1...8 copies the
+ * coefficients out of the (strided) view together with the coefficients of
+ * the derivative (fit_poly::vel_coeffs if they were precomputed); loops
+ * with compile time trip counts are unrolled and the coefficients stay in
+ * registers. poly_orbit<0> reads the degree at run time and handles any
+ * other degree. Both compute the same floating point operations in the
+ * same order. */
+
+template<size_t deg>
+struct poly_orbit {
+    double mean_t, start_t, stop_t, mean_coords[3];
+    bool is_centered;
+    
+    // position and velocity coefficients, highest power first
+    double pc[3][deg + 1], vc[3][deg + 1];
+    
+    poly_orbit(const fit_poly& orb): mean_t(orb.mean_t), start_t(orb.start_t),
+                                     stop_t(orb.stop_t),
+                                     is_centered(orb.is_centered)
+    {
+        FOR(jj, 3) {
+            mean_coords[jj] = is_centered ? orb.mean_coords[jj] : 0.0;
+            
+            FOR(ii, deg + 1) {
+                pc[jj][ii] = orb.coeffs(jj, ii);
+                vc[jj][ii] = orb.vel_coeffs != NULL
+                             ? (*orb.vel_coeffs)(jj, ii)
+                             : double(deg - ii) * orb.coeffs(jj, ii);
+            }
+        }
+    }
+    
+    size_t n_poly() const { return deg + 1; }
+    double pos_coeff(size_t jj, size_t ii) const { return pc[jj][ii]; }
+    double vel_coeff(size_t jj, size_t ii) const { return vc[jj][ii]; }
+};
+
+
+template<>
+struct poly_orbit<0> {
+    double mean_t, start_t, stop_t, mean_coords[3];
+    bool is_centered;
+    
+    view<double> const& coeffs;
+    view<double> const *vcoeffs;
+    size_t n;
+    
+    poly_orbit(const fit_poly& orb): mean_t(orb.mean_t), start_t(orb.start_t),
+                                     stop_t(orb.stop_t),
+                                     is_centered(orb.is_centered),
+                                     coeffs(orb.coeffs),
+                                     vcoeffs(orb.vel_coeffs), n(orb.deg + 1)
+    {
+        FOR(jj, 3)
+            mean_coords[jj] = is_centered ? orb.mean_coords[jj] : 0.0;
+    }
+    
+    size_t n_poly() const { return n; }
+    double pos_coeff(size_t jj, size_t ii) const { return coeffs(jj, ii); }
+    
+    double vel_coeff(size_t jj, size_t ii) const
+    {
+        if (vcoeffs != NULL)
+            return (*vcoeffs)(jj, ii);
+        
+        return double(n - 1 - ii) * coeffs(jj, ii);
+    }
+};
+
+
 // Calculate satellite position based on fitted polynomial orbits at time
-static inline void calc_pos(const fit_poly& orb, double time, cart& pos)
+template<class Orbit>
+static inline void calc_pos(Orbit const& orb, double time, cart& pos)
 {
-    size_t n_poly = orb.deg + 1, is_centered = orb.is_centered;
-    double x = 0.0, y = 0.0, z = 0.0;
-    
-    view<double> const& coeffs = orb.coeffs;
-    double const *mean_coords = orb.mean_coords;
+    size_t const n_poly = orb.n_poly();
+    double p[3];
     
-    if (is_centered)
+    if (orb.is_centered)
         time -= orb.mean_t;
     
-    if(n_poly == 2) {
-        x = coeffs(0,0) * time + coeffs(0,1);
-        y = coeffs(1,0) * time + coeffs(1,1);
-        z = coeffs(2,0) * time + coeffs(2,1);
+    FOR(jj, 3) {
+        p[jj] = orb.pos_coeff(jj, 0) * time;
+        
+        FOR1(ii, 1, n_poly - 1)
+            p[jj] = (p[jj] + orb.pos_coeff(jj, ii)) * time;
+        
+        p[jj] += orb.pos_coeff(jj, n_poly - 1);
+        
+        if (orb.is_centered)
+            p[jj] += orb.mean_coords[jj];
     }
-    else {
-        x = coeffs(0,0)  * time;
-        y = coeffs(1,0)  * time;
-        z = coeffs(2,0)  * time;
+    
+    pos.x = p[0]; pos.y = p[1]; pos.z = p[2];
+} // calc_pos
+
 
+// Satellite position and velocity at time, both polynoms are evaluated in
+// the same pass (Horner).
+template<class Orbit>
+static inline void calc_pos_vel(Orbit const& orb, double time, double pos[3],
+                                double vel[3])
+{
+    size_t const n_poly = orb.n_poly();
+    
+    if (orb.is_centered)
+        time -= orb.mean_t;
+    
+    FOR(jj, 3) {
+        double p = orb.pos_coeff(jj, 0) * time, v = orb.vel_coeff(jj, 0);
+        
         FOR1(ii, 1, n_poly - 1) {
-            x = (x + coeffs(0,ii)) * time;
-            y = (y + coeffs(1,ii)) * time;
-            z = (z + coeffs(2,ii)) * time;
+            p = (p + orb.pos_coeff(jj, ii)) * time;
+            v = v * time + orb.vel_coeff(jj, ii);
         }
         
-        x += coeffs(0,n_poly - 1);
-        y += coeffs(1,n_poly - 1);
-        z += coeffs(2,n_poly - 1);
-    }
-    
-    if (is_centered) {
-        x += mean_coords[0];
-        y += mean_coords[1];
-        z += mean_coords[2];
+        p += orb.pos_coeff(jj, n_poly - 1);
+        
+        if (orb.is_centered)
+            p += orb.mean_coords[jj];
+        
+        pos[jj] = p;
+        vel[jj] = v;
     }
-    
-    pos.x = x; pos.y = y; pos.z = z;
-} // calc_pos
+} // calc_pos_vel
 
 
-static inline double dot_product(const fit_poly& orb, cdouble X, cdouble Y,
+template<class Orbit>
+static inline double dot_product(Orbit const& orb, cdouble X, cdouble Y,
                                  cdouble Z, double time)
 {
     /* Calculate dot product between satellite velocity vector and
      * and vector between ground position and satellite position. */
     
-    double dx, dy, dz, sat_x = 0.0, sat_y = 0.0, sat_z = 0.0,
-                       vel_x, vel_y, vel_z, power, inorm;
-    size_t n_poly = orb.deg + 1;
+    double sat[3], vel[3], dx, dy, dz, inorm;
+    
+    calc_pos_vel(orb, time, sat, vel);
+    
+    // satellite coordinates - GNSS coordinates
+    dx = sat[0] - X;
+    dy = sat[1] - Y;
+    dz = sat[2] - Z;
+    
+    // product of inverse norms
+    inorm = (1.0 / norm(dx, dy, dz)) * (1.0 / norm(vel[0], vel[1], vel[2]));
     
-    view<double> const &coeffs = orb.coeffs;
-    double const *mean_coords = orb.mean_coords;
+    return (vel[0] * dx  + vel[1] * dy  + vel[2] * dz) * inorm;
+} // dot_product
+
+
+// Satellite position, velocity, acceleration and jerk at time. The
+// derivatives are accumulated together with the polynom value (Horner).
+template<class Orbit>
+static inline void calc_state(Orbit const& orb, double time, cart& pos,
+                              cart& vel, cart& acc, cart& jerk)
+{
+    size_t const n_poly = orb.n_poly();
     
     if (orb.is_centered)
         time -= orb.mean_t;
     
-    // linear case 
-    if(n_poly == 2) {
-        sat_x = coeffs(0,0) * time + coeffs(0,1);
-        sat_y = coeffs(1,0) * time + coeffs(1,1);
-        sat_z = coeffs(2,0) * time + coeffs(2,1);
+    double p[3], p1[3], p2[3], p3[3];
+    
+    FOR(jj, 3) {
+        p[jj] = orb.pos_coeff(jj, 0);
+        p1[jj] = p2[jj] = p3[jj] = 0.0;
         
-        vel_x = coeffs(0,0); vel_y = coeffs(1,0); vel_z = coeffs(2,0);
+        FOR1(ii, 1, n_poly) {
+            p3[jj] = p3[jj] * time + p2[jj];
+            p2[jj] = p2[jj] * time + p1[jj];
+            p1[jj] = p1[jj] * time + p[jj];
+            p[jj]  = p[jj]  * time + orb.pos_coeff(jj, ii);
+        }
     }
-    // evaluation of polynom with Horner's method
-    else {
-        
-        sat_x = coeffs(0,0)  * time;
-        sat_y = coeffs(1,0)  * time;
-        sat_z = coeffs(2,0)  * time;
+    
+    if (orb.is_centered) {
+        FOR(jj, 3)
+            p[jj] += orb.mean_coords[jj];
+    }
+    
+    pos.x = p[0];  pos.y = p[1];  pos.z = p[2];
+    vel.x = p1[0]; vel.y = p1[1]; vel.z = p1[2];
+    acc.x = 2.0 * p2[0]; acc.y = 2.0 * p2[1]; acc.z = 2.0 * p2[2];
+    jerk.x = 6.0 * p3[0]; jerk.y = 6.0 * p3[1]; jerk.z = 6.0 * p3[2];
+} // calc_state
 
-        FOR1(ii, 1, n_poly - 1) {
-            sat_x = (sat_x + coeffs(0,ii)) * time;
-            sat_y = (sat_y + coeffs(1,ii)) * time;
-            sat_z = (sat_z + coeffs(2,ii)) * time;
+
+/* Chebyshev series orbit, evaluated with the Clenshaw recursion.
+ *
+ * The series of the velocity, acceleration and jerk are derived once, when
+ * the orbit is set up, with the scaling of time to [-1, 1] folded into
+ * their coefficients. All of them are evaluated in the same pass. */
+
+struct cheb_orbit {
+    double start_t, stop_t, mid_t, scale, mean_coords[3];
+    bool is_centered;
+    size_t n;
+    
+    // series of position, velocity, acceleration and jerk
+    double coeffs[4][3][max_cheb_deg + 1];
+    
+    cheb_orbit(const fit_poly& orb): start_t(orb.start_t), stop_t(orb.stop_t),
+                                     mid_t((orb.start_t + orb.stop_t) / 2.0),
+                                     scale(2.0 / (orb.stop_t - orb.start_t)),
+                                     is_centered(orb.is_centered),
+                                     n(orb.deg + 1)
+    {
+        FOR(jj, 3) {
+            mean_coords[jj] = is_centered ? orb.mean_coords[jj] : 0.0;
+            
+            FOR(ii, n)
+                coeffs[0][jj][ii] = orb.coeffs(jj, ii);
+            
+            // derivative series: d[k] = d[k + 2] + 2 (k + 1) a[k + 1],
+            // d[0] is halved
+            FOR1(kk, 1, 4) {
+                double const *a = coeffs[kk - 1][jj];
+                double *d = coeffs[kk][jj];
+                
+                d[n - 1] = 0.0;
+                
+                FOR(ii, n - 1)
+                    d[ii] = (ii + 2 < n ? d[ii + 2] : 0.0)
+                          + 2.0 * double(ii + 1) * a[ii + 1];
+                
+                d[0] /= 2.0;
+                
+                FOR(ii, n)
+                    d[ii] *= scale;
+            }
         }
-        
-        sat_x += coeffs(0,n_poly - 1);
-        sat_y += coeffs(1,n_poly - 1);
-        sat_z += coeffs(2,n_poly - 1);
+    }
+};
 
-        vel_x = coeffs(0, n_poly - 2);
-        vel_y = coeffs(1, n_poly - 2);
-        vel_z = coeffs(2, n_poly - 2);
-        
-        FOR1(ii, 0, n_poly - 3) {
-            power = double(n_poly - 1.0 - ii);
-            vel_x += ii * coeffs(0,ii) * pow(time, power);
-            vel_y += ii * coeffs(1,ii) * pow(time, power);
-            vel_z += ii * coeffs(2,ii) * pow(time, power);
+
+/* Runs kernel.run<Orbit>() with the orbit type of basis and deg: cheb_orbit,
+ * poly_orbit<deg> for deg = 1...8, poly_orbit<0> for any other degree. The
+ * only place where the degree of the polynom is branched on; the kernel
+ * holds the arguments and constructs the orbit it needs. */
+template<class Kernel>
+static bool orbit_dispatch(poly_basis const basis, size_t const deg,
+                           Kernel const& kernel)
+{
+    if (basis == basis_chebyshev)
+        return kernel.template run<cheb_orbit>();
+    
+    switch (deg) {
+        case 1: return kernel.template run<poly_orbit<1> >();
+        case 2: return kernel.template run<poly_orbit<2> >();
+        case 3: return kernel.template run<poly_orbit<3> >();
+        case 4: return kernel.template run<poly_orbit<4> >();
+        case 5: return kernel.template run<poly_orbit<5> >();
+        case 6: return kernel.template run<poly_orbit<6> >();
+        case 7: return kernel.template run<poly_orbit<7> >();
+        case 8: return kernel.template run<poly_orbit<8> >();
+        default: return kernel.template run<poly_orbit<0> >();
+    }
+} // orbit_dispatch
+
+
+// first nser series (position, velocity, ...) of the orbit at time
+static inline void clenshaw(cheb_orbit const& orb, size_t const nser,
+                            double const time, double out[][3])
+{
+    size_t const n = orb.n;
+    double const u = (time - orb.mid_t) * orb.scale, u2 = 2.0 * u;
+    
+    FOR(kk, nser) {
+        FOR(jj, 3) {
+            double const *a = orb.coeffs[kk][jj];
+            double b1 = 0.0, b2 = 0.0, b0;
+            
+            FOR(ii, n - 1) {
+                b0 = a[ii + 1] + u2 * b1 - b2;
+                b2 = b1;
+                b1 = b0;
+            }
+            
+            out[kk][jj] = a[0] + u * b1 - b2;
         }
     }
     
     if (orb.is_centered) {
-        sat_x += mean_coords[0];
-        sat_y += mean_coords[1];
-        sat_z += mean_coords[2];
+        FOR(jj, 3)
+            out[0][jj] += orb.mean_coords[jj];
     }
+} // clenshaw
+
+
+static inline void calc_pos(cheb_orbit const& orb, double time, cart& pos)
+{
+    double s[1][3];
     
-    // satellite coordinates - GNSS coordinates
-    dx = sat_x - X;
-    dy = sat_y - Y;
-    dz = sat_z - Z;
+    clenshaw(orb, 1, time, s);
     
-    // product of inverse norms
-    inorm = (1.0 / norm(dx, dy, dz)) * (1.0 / norm(vel_x, vel_y, vel_z));
+    pos.x = s[0][0]; pos.y = s[0][1]; pos.z = s[0][2];
+}
+
+
+static inline void calc_pos_vel(cheb_orbit const& orb, double time,
+                                double pos[3], double vel[3])
+{
+    double s[2][3];
     
-    return (vel_x * dx  + vel_y * dy  + vel_z * dz) * inorm;
-} // dot_product
+    clenshaw(orb, 2, time, s);
+    
+    FOR(jj, 3) {
+        pos[jj] = s[0][jj];
+        vel[jj] = s[1][jj];
+    }
+}
+
+
+static inline void calc_state(cheb_orbit const& orb, double time, cart& pos,
+                              cart& vel, cart& acc, cart& jerk)
+{
+    double s[4][3];
+    
+    clenshaw(orb, 4, time, s);
+    
+    pos.x = s[0][0];  pos.y = s[0][1];  pos.z = s[0][2];
+    vel.x = s[1][0];  vel.y = s[1][1];  vel.z = s[1][2];
+    acc.x = s[2][0];  acc.y = s[2][1];  acc.z = s[2][2];
+    jerk.x = s[3][0]; jerk.y = s[3][1]; jerk.z = s[3][2];
+}
+
+
+/* Searching for the zero-Doppler time.
+ *
+ * Cold start: the bracket is the whole orbit window extended by 5 seconds.
+ * Warm start: the search is seeded with the zero-Doppler time of the
+ * previous point. The bracket [seed - warm_width, seed + warm_width] is
+ * widened by warm_grow until it contains a sign change of the dot product
+ * (or covers the orbit window). */
+
+static const double warm_width = 1.0e-3, warm_grow = 8.0;
+
+// search window of the zero-Doppler time
+struct bracket {
+    double t_start, t_stop, dot_start;
+};
+
+
+template<class Orbit>
+static inline size_t cold_bracket(Orbit const& orb, cdouble X, cdouble Y,
+                                  cdouble Z, bracket& br)
+{
+    // first and last time, extending the time window by 5 seconds
+    br.t_start = orb.start_t - 5.0;
+    br.t_stop  = orb.stop_t + 5.0;
+    br.dot_start = dot_product(orb, X, Y, Z, br.t_start);
+    
+    return 0;
+} // cold_bracket
+
+
+// returns the number of dot product evaluations
+template<class Orbit>
+static inline size_t warm_bracket(Orbit const& orb, cdouble X, cdouble Y,
+                                  cdouble Z, cdouble seed, bracket& br)
+{
+    double const t_min = orb.start_t - 5.0, t_max = orb.stop_t + 5.0;
+    double half = warm_width, dot_stop;
+    size_t itr = 0;
+    
+    while (true) {
+        br.t_start = seed - half > t_min ? seed - half : t_min;
+        br.t_stop  = seed + half < t_max ? seed + half : t_max;
+        
+        br.dot_start = dot_product(orb, X, Y, Z, br.t_start);
+        dot_stop = dot_product(orb, X, Y, Z, br.t_stop);
+        itr += 2;
+        
+        if (not (br.dot_start * dot_stop > 0.0)
+            or (br.t_start == t_min and br.t_stop == t_max))
+            break;
+        
+        half *= warm_grow;
+    }
+    
+    return itr;
+} // warm_bracket
 
 
-// Compute the sat position using closest approche.
-static inline void closest_appr(const fit_poly& orb, cdouble X, cdouble Y,
-                                cdouble Z, size_t max_iter, cart& sat_pos)
+// Compute the sat position using closest approche, returns the number of
+// iterations.
+template<class Orbit>
+static inline size_t closest_appr(Orbit const& orb, cdouble X, cdouble Y,
+                                  cdouble Z, size_t max_iter,
+                                  bracket const& br, cart& sat_pos,
+                                  double& t_zd)
 {
-    // first, last and middle time, extending the time window by 5 seconds
-    double t_start = orb.start_t - 5.0,
-           t_stop  = orb.stop_t + 5.0,
+    // first, last and middle time
+    double t_start = br.t_start,
+           t_stop  = br.t_stop,
            t_middle = 0.0;
     
     // dot products
-    double dot_start, dot_middle = 1.0;
+    double dot_start = br.dot_start, dot_middle = 1.0;
 
     // iteration counter
     size_t itr = 0;
     
-    dot_start = dot_product(orb, X, Y, Z, t_start);
-    
     while( fabs(dot_middle) > 1.0e-11 && itr < max_iter) {
         t_middle = (t_start + t_stop) / 2.0;
 
@@ -175,9 +455,107 @@ static inline void closest_appr(const fit_poly& orb, cdouble X, cdouble Y,
     
     // calculate satellite position at middle time
     calc_pos(orb, t_middle, sat_pos);
+    
+    t_zd = t_middle;
+    return itr;
 } // closest_appr
 
 
+/* Zero-Doppler time with Newton or Halley steps on
+ * f(t) = v(t) * (s(t) - P), where s and v are the satellite position and
+ * velocity, starting from time. f increases with t (|v|^2 dominates
+ * f' = a * (s - P) + |v|^2 for any low Earth orbit), so every evaluation
+ * shrinks the [t_start, t_stop] bracket and a bisection step is taken
+ * whenever the Newton/Halley step would leave it. Converges with the same
+ * criterion as closest_appr (cosine of the angle between velocity and line
+ * of sight). Returns the number of iterations. */
+template<class Orbit>
+static inline size_t closest_appr_newton(Orbit const& orb, cdouble X,
+                                         cdouble Y, cdouble Z,
+                                         size_t max_iter, zd_solver solver,
+                                         double t_start, double t_stop,
+                                         double time, cart& sat_pos,
+                                         double& t_zd)
+{
+    double dx, dy, dz, f, df, ddf, t_new;
+    cart pos, vel, acc, jerk;
+    size_t itr = 0;
+    
+    while (itr < max_iter) {
+        calc_state(orb, time, pos, vel, acc, jerk);
+        itr++;
+        
+        dx = pos.x - X;
+        dy = pos.y - Y;
+        dz = pos.z - Z;
+        
+        f = vel.x * dx + vel.y * dy + vel.z * dz;
+        
+        if (fabs(f) <= 1.0e-11 * norm(dx, dy, dz) * norm(vel.x, vel.y, vel.z))
+            break;
+        
+        // shrink bracket
+        if (f > 0.0)
+            t_stop = time;
+        else
+            t_start = time;
+        
+        df = (acc.x * dx + acc.y * dy + acc.z * dz)
+           + (vel.x * vel.x + vel.y * vel.y + vel.z * vel.z);
+        
+        if (solver == zd_halley) {
+            ddf = jerk.x * dx + jerk.y * dy + jerk.z * dz
+                + 3.0 * (acc.x * vel.x + acc.y * vel.y + acc.z * vel.z);
+            t_new = time - 2.0 * f * df / (2.0 * df * df - f * ddf);
+        }
+        else
+            t_new = time - f / df;
+        
+        // unsafe step (also catches NaN), fall back to bisection
+        if (not (t_new > t_start and t_new < t_stop))
+            t_new = (t_start + t_stop) / 2.0;
+        
+        time = t_new;
+    }
+    
+    calc_pos(orb, time, sat_pos);
+    
+    t_zd = time;
+    return itr;
+} // closest_appr_newton
+
+
+// Satellite position at zero-Doppler time. A seed outside of the orbit
+// window (e.g. HUGE_VAL) means cold start. Returns the number of iterations.
+template<class Orbit>
+static inline size_t zero_doppler(Orbit const& orb, cdouble X, cdouble Y,
+                                  cdouble Z, zd_params const& par,
+                                  cdouble seed, cart& sat_pos, double& t_zd)
+{
+    double const t_min = orb.start_t - 5.0, t_max = orb.stop_t + 5.0;
+    
+    bool const warm = seed >= t_min and seed <= t_max;
+    
+    if (par.solver != zd_bisect) {
+        // Newton does not need a verified bracket, only a starting point
+        double time = warm ? seed : (t_min + t_max) / 2.0;
+        
+        return closest_appr_newton(orb, X, Y, Z, par.max_iter, par.solver,
+                                   t_min, t_max, time, sat_pos, t_zd);
+    }
+    
+    bracket br;
+    size_t itr;
+    
+    if (warm)
+        itr = warm_bracket(orb, X, Y, Z, seed, br);
+    else
+        itr = cold_bracket(orb, X, Y, Z, br);
+    
+    return itr + closest_appr(orb, X, Y, Z, par.max_iter, br, sat_pos, t_zd);
+} // zero_doppler
+
+
 void ell_cart (cdouble lon, cdouble lat, cdouble h,
                double& x, double& y, double& z)
 {
@@ -211,90 +589,2474 @@ void cart_ell(cdouble x, cdouble y, cdouble z,
     h = p / co - n;
 } // cart_ell
 
+// Azimuth and incidence angle from the topocentric (north, east, up)
+// coordinates of the ground point - satellite vector.
+static inline void topo_angles(cdouble xl, cdouble yl, cdouble zl, cdouble t0,
+                               double& azi, double& inc)
+{
+    double _xl = xl;
+    
+    inc = acos(zl / t0) * rad2deg;
+    
+    if(_xl == 0.0) _xl = 0.000000001;
+    
+    double temp_azi = atan(fabs(yl / _xl));
+    
+    if( (_xl < 0.0) && (yl > 0.0) ) temp_azi = pi - temp_azi;
+    if( (_xl < 0.0) && (yl < 0.0) ) temp_azi = pi + temp_azi;
+    if( (_xl > 0.0) && (yl < 0.0) ) temp_azi = 2.0 * pi - temp_azi;
+    
+    temp_azi *= rad2deg;
+    
+    if(temp_azi > 180.0)
+        temp_azi -= 180.0;
+    else
+        temp_azi += 180.0;
+    
+    azi = temp_azi;
+} // topo_angles
+
+
+// geom_ncols(output) values of out from the topocentric vector, go_radar
+// is handled by _azi_inc
+static inline void topo_output(cdouble xl, cdouble yl, cdouble zl, cdouble t0,
+                               geom_output const output, double out[])
+{
+    if (output == go_angles or output == go_angles_range) {
+        topo_angles(xl, yl, zl, t0, out[0], out[1]);
+        out[2] = t0;
+        return;
+    }
+    
+    // no angles, acos, atan and the wrapping are skipped
+    out[0] = yl / t0;
+    out[1] = xl / t0;
+    out[2] = zl / t0;
+    out[3] = t0;
+} // topo_output
 
 
-static inline void _azi_inc(const fit_poly& orb, cdouble X, cdouble Y,
-                            cdouble Z, cdouble lon, cdouble lat,
-                            size_t max_iter, double& azi, double& inc)
+template<class Orbit>
+static inline size_t _azi_inc(Orbit const& orb, cdouble X, cdouble Y,
+                              cdouble Z, cdouble lon, cdouble lat,
+                              zd_params const& par, double& t_zd,
+                              double out[])
 {
-    double xf, yf, zf, xl, yl, zl, t0;
+    double xf, yf, zf, xl, yl, zl, t0, slat, clat, slon, clon;
+    size_t itr;
     cart sat;
     
-    // satellite closest approache cooridantes
-    closest_appr(orb, X, Y, Z, max_iter, sat);
+    // satellite closest approache cooridantes, t_zd holds the seed on input
+    itr = zero_doppler(orb, X, Y, Z, par, t_zd, sat, t_zd);
     
     xf = sat.x - X;
     yf = sat.y - Y;
     zf = sat.z - Z;
     
+    if (par.output == go_radar) {
+        double pos[3], vel[3];
+        
+        calc_pos_vel(orb, t_zd, pos, vel);
+        
+        out[0] = t_zd;
+        out[1] = norm(xf, yf, zf);
+        out[2] = sat.x; out[3] = sat.y; out[4] = sat.z;
+        out[5] = vel[0]; out[6] = vel[1]; out[7] = vel[2];
+        
+        return itr;
+    }
+    
+    slat = sin(lat); clat = cos(lat);
+    slon = sin(lon); clon = cos(lon);
+    
     // estiamtion of azimuth and inclination
-    xl = - sin(lat) * cos(lon) * xf
-         - sin(lat) * sin(lon) * yf + cos(lat) * zf ;
+    xl = - slat * clon * xf - slat * slon * yf + clat * zf ;
     
-    yl = - sin(lon) * xf + cos(lon) * yf;
+    yl = - slon * xf + clon * yf;
     
-    zl = + cos(lat) * cos(lon) * xf
-         + cos(lat) * sin(lon) * yf + sin(lat) * zf ;
+    zl = + clat * clon * xf + clat * slon * yf + slat * zf ;
     
     t0 = norm(xl, yl, zl);
     
-    inc = acos(zl / t0) * rad2deg;
+    topo_output(xl, yl, zl, t0, par.output, out);
     
-    if(xl == 0.0) xl = 0.000000001;
+    return itr;
+} // _azi_inc
+
+
+/****************************************
+ * Batched evaluation, SIMD_WIDTH lanes *
+ ****************************************/
+
+/* The functions below are lane-wise copies of calc_pos, dot_product,
+ * closest_appr and _azi_inc. Every lane performs exactly the same
+ * sequence of floating point operations as the scalar code, so results
+ * do not depend on whether a point ends up in a block or in the tail. */
+
+// SoA storage of SIMD_WIDTH ground points
+struct point_block {
+    double X[SIMD_WIDTH], Y[SIMD_WIDTH], Z[SIMD_WIDTH],
+           slat[SIMD_WIDTH], clat[SIMD_WIDTH], slon[SIMD_WIDTH],
+           clon[SIMD_WIDTH], niter[SIMD_WIDTH], seed[SIMD_WIDTH];
     
-    double temp_azi = atan(fabs(yl / xl));
+    // geom_ncols(par.output) rows of results
+    double out[max_geom_ncols][SIMD_WIDTH];
+};
+
+
+template<class Orbit>
+static inline void vcalc_pos(Orbit const& orb, vdouble time, vdouble& x,
+                             vdouble& y, vdouble& z)
+{
+    size_t const n_poly = orb.n_poly();
+    vdouble p[3];
     
-    if( (xl < 0.0) && (yl > 0.0) ) temp_azi = pi - temp_azi;
-    if( (xl < 0.0) && (yl < 0.0) ) temp_azi = pi + temp_azi;
-    if( (xl > 0.0) && (yl < 0.0) ) temp_azi = 2.0 * pi - temp_azi;
+    if (orb.is_centered)
+        time = time - vdouble(orb.mean_t);
     
-    temp_azi *= rad2deg;
+    FOR(jj, 3) {
+        p[jj] = vdouble(orb.pos_coeff(jj, 0)) * time;
+        
+        FOR1(ii, 1, n_poly - 1)
+            p[jj] = (p[jj] + vdouble(orb.pos_coeff(jj, ii))) * time;
+        
+        p[jj] = p[jj] + vdouble(orb.pos_coeff(jj, n_poly - 1));
+        
+        if (orb.is_centered)
+            p[jj] = p[jj] + vdouble(orb.mean_coords[jj]);
+    }
     
-    if(temp_azi > 180.0)
-        temp_azi -= 180.0;
-    else
-        temp_azi += 180.0;
+    x = p[0]; y = p[1]; z = p[2];
+} // vcalc_pos
+
+
+// lane-wise calc_pos_vel
+template<class Orbit>
+static inline void vcalc_pos_vel(Orbit const& orb, vdouble time,
+                                 vdouble pos[3], vdouble vel[3])
+{
+    size_t const n_poly = orb.n_poly();
     
-    azi = temp_azi;
-} // calc_azi_inc
+    if (orb.is_centered)
+        time = time - vdouble(orb.mean_t);
+    
+    FOR(jj, 3) {
+        vdouble p = vdouble(orb.pos_coeff(jj, 0)) * time,
+                v = orb.vel_coeff(jj, 0);
+        
+        FOR1(ii, 1, n_poly - 1) {
+            p = (p + vdouble(orb.pos_coeff(jj, ii))) * time;
+            v = v * time + vdouble(orb.vel_coeff(jj, ii));
+        }
+        
+        p = p + vdouble(orb.pos_coeff(jj, n_poly - 1));
+        
+        if (orb.is_centered)
+            p = p + vdouble(orb.mean_coords[jj]);
+        
+        pos[jj] = p;
+        vel[jj] = v;
+    }
+} // vcalc_pos_vel
 
 
-void calc_azi_inc(const fit_poly& orb, view<double> const& coords,
-                  view<double>& azi_inc, size_t const max_iter,
-                  bool const is_lonlat)
+template<class Orbit>
+static inline void vcalc_state(Orbit const& orb, vdouble time,
+                               vdouble pos[3], vdouble vel[3], vdouble acc[3],
+                               vdouble jerk[3])
 {
-    double X, Y, Z, lon, lat, h;
-    X = Y = Z = lon = lat = h = 0.0;
+    size_t const n_poly = orb.n_poly();
+    vdouble const zero = 0.0;
     
-    size_t nrows = coords.shape[0];
+    if (orb.is_centered)
+        time = time - vdouble(orb.mean_t);
     
-    // coords contains lon, lat, h
-    if (is_lonlat) {
-        FOR(ii, nrows) {
-            lon = coords(ii, 0) * deg2rad;
-            lat = coords(ii, 1) * deg2rad;
-            h   = coords(ii, 2);
-            
-            // calulate surface WGS-84 Cartesian coordinates
-            ell_cart(lon, lat, h, X, Y, Z);
+    FOR(jj, 3) {
+        vdouble p = orb.pos_coeff(jj, 0), p1 = zero, p2 = zero, p3 = zero;
+        
+        FOR1(ii, 1, n_poly) {
+            p3 = p3 * time + p2;
+            p2 = p2 * time + p1;
+            p1 = p1 * time + p;
+            p  = p  * time + vdouble(orb.pos_coeff(jj, ii));
+        }
+        
+        if (orb.is_centered)
+            p = p + vdouble(orb.mean_coords[jj]);
+        
+        pos[jj] = p;
+        vel[jj] = p1;
+        acc[jj] = vdouble(2.0) * p2;
+        jerk[jj] = vdouble(6.0) * p3;
+    }
+} // vcalc_state
+
+
+// lane-wise clenshaw
+static inline void vclenshaw(cheb_orbit const& orb, size_t const nser,
+                             vdouble const time, vdouble out[][3])
+{
+    size_t const n = orb.n;
+    vdouble const u = (time - vdouble(orb.mid_t)) * vdouble(orb.scale),
+                  u2 = vdouble(2.0) * u;
+    
+    FOR(kk, nser) {
+        FOR(jj, 3) {
+            double const *a = orb.coeffs[kk][jj];
+            vdouble b1 = 0.0, b2 = 0.0, b0;
             
-            _azi_inc(orb, X, Y, Z, lon, lat, max_iter,
-                     azi_inc(ii, 0), azi_inc(ii, 1));
+            FOR(ii, n - 1) {
+                b0 = vdouble(a[ii + 1]) + u2 * b1 - b2;
+                b2 = b1;
+                b1 = b0;
+            }
             
-        } // for
+            out[kk][jj] = vdouble(a[0]) + u * b1 - b2;
+        }
     }
-    // coords contains X, Y, Z
-    else {
-        FOR(ii, nrows) {
-            X = coords(ii, 0);
-            Y = coords(ii, 1);
-            Z = coords(ii, 2);
-            
-            // calulate surface WGS-84 geodetic coordinates
-            cart_ell(X, Y, Z, lon, lat, h);
-        
-            _azi_inc(orb, X, Y, Z, lon, lat, max_iter,
-                     azi_inc(ii, 0), azi_inc(ii, 1));
-        } // for
-    } // if
+    
+    if (orb.is_centered) {
+        FOR(jj, 3)
+            out[0][jj] = out[0][jj] + vdouble(orb.mean_coords[jj]);
+    }
+} // vclenshaw
+
+
+static inline void vcalc_pos(cheb_orbit const& orb, vdouble const time,
+                             vdouble& x, vdouble& y, vdouble& z)
+{
+    vdouble s[1][3];
+    
+    vclenshaw(orb, 1, time, s);
+    
+    x = s[0][0]; y = s[0][1]; z = s[0][2];
+}
+
+
+static inline void vcalc_pos_vel(cheb_orbit const& orb, vdouble const time,
+                                 vdouble pos[3], vdouble vel[3])
+{
+    vdouble s[2][3];
+    
+    vclenshaw(orb, 2, time, s);
+    
+    FOR(jj, 3) {
+        pos[jj] = s[0][jj];
+        vel[jj] = s[1][jj];
+    }
+}
+
+
+static inline void vcalc_state(cheb_orbit const& orb, vdouble const time,
+                               vdouble pos[3], vdouble vel[3], vdouble acc[3],
+                               vdouble jerk[3])
+{
+    vdouble s[4][3];
+    
+    vclenshaw(orb, 4, time, s);
+    
+    FOR(jj, 3) {
+        pos[jj] = s[0][jj];
+        vel[jj] = s[1][jj];
+        acc[jj] = s[2][jj];
+        jerk[jj] = s[3][jj];
+    }
+}
+
+
+template<class Orbit>
+static inline vdouble vdot_product(Orbit const& orb, vdouble const X,
+                                   vdouble const Y, vdouble const Z,
+                                   vdouble const time)
+{
+    vdouble sat[3], vel[3], dx, dy, dz, inorm;
+    
+    vcalc_pos_vel(orb, time, sat, vel);
+    
+    dx = sat[0] - X;
+    dy = sat[1] - Y;
+    dz = sat[2] - Z;
+    
+    inorm = (vdouble(1.0) / vsqrt(dx * dx + dy * dy + dz * dz))
+          * (vdouble(1.0) / vsqrt(vel[0] * vel[0] + vel[1] * vel[1]
+                                  + vel[2] * vel[2]));
+    
+    return (vel[0] * dx + vel[1] * dy + vel[2] * dz) * inorm;
+} // vdot_product
+
+
+// lane-wise warm_bracket, cold lanes get the whole orbit window
+template<class Orbit>
+static inline void vbracket(Orbit const& orb, vdouble const X,
+                            vdouble const Y, vdouble const Z, vmask const warm,
+                            vdouble const seed, vdouble& t_start,
+                            vdouble& t_stop, vdouble& dot_start,
+                            vdouble& niter)
+{
+    vdouble const t_min = orb.start_t - 5.0, t_max = orb.stop_t + 5.0,
+                  zero = 0.0, two = 2.0;
+    vdouble half = vselect(warm, vdouble(warm_width), vdouble(1.0e300)),
+            ts, te, ds, de;
+    
+    vmask pending = vgt(two, zero), full;
+    
+    while (vany(pending)) {
+        ts = vmax(seed - half, t_min);
+        te = vmin(seed + half, t_max);
+        
+        ds = vdot_product(orb, X, Y, Z, ts);
+        de = vdot_product(orb, X, Y, Z, te);
+        
+        t_start = vselect(pending, ts, t_start);
+        t_stop = vselect(pending, te, t_stop);
+        dot_start = vselect(pending, ds, dot_start);
+        niter = vselect(pending & warm, niter + two, niter);
+        
+        full = vandnot(vgt(ts, t_min), vandnot(vgt(t_max, te), pending));
+        pending = vandnot(full, pending & vgt(ds * de, zero));
+        half = half * vdouble(warm_grow);
+    }
+} // vbracket
+
+
+template<class Orbit>
+static inline void vclosest_appr(Orbit const& orb, vdouble const X,
+                                 vdouble const Y, vdouble const Z,
+                                 size_t max_iter, vdouble t_start,
+                                 vdouble t_stop, vdouble dot_start,
+                                 vdouble& sat_x, vdouble& sat_y,
+                                 vdouble& sat_z, vdouble& t_zd,
+                                 vdouble& niter)
+{
+    vdouble t_middle = 0.0, dot_middle = 1.0, tmp;
+    
+    vdouble const tol = 1.0e-11, zero = 0.0, one = 1.0;
+    
+    // lanes that have not converged yet
+    vmask active = vgt(vabs(dot_middle), tol), same;
+    
+    size_t itr = 0;
+    
+    while (vany(active) and itr < max_iter) {
+        t_middle = vselect(active, (t_start + t_stop) / vdouble(2.0), t_middle);
+        
+        tmp = vdot_product(orb, X, Y, Z, t_middle);
+        dot_middle = vselect(active, tmp, dot_middle);
+        
+        same = active & vgt(dot_start * dot_middle, zero);
+        
+        t_start = vselect(same, t_middle, t_start);
+        dot_start = vselect(same, dot_middle, dot_start);
+        t_stop = vselect(vandnot(same, active), t_middle, t_stop);
+        
+        niter = vselect(active, niter + one, niter);
+        active = active & vgt(vabs(dot_middle), tol);
+        itr++;
+    }
+    
+    vcalc_pos(orb, t_middle, sat_x, sat_y, sat_z);
+    t_zd = t_middle;
+} // vclosest_appr
+
+
+static inline vdouble vdot(vdouble const a[3], vdouble const b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+
+template<class Orbit>
+static inline void vclosest_appr_newton(Orbit const& orb, vdouble const X,
+                                        vdouble const Y, vdouble const Z,
+                                        size_t max_iter, zd_solver solver,
+                                        vdouble t_start, vdouble t_stop,
+                                        vdouble time, vdouble& sat_x,
+                                        vdouble& sat_y, vdouble& sat_z,
+                                        vdouble& t_zd, vdouble& niter)
+{
+    vdouble f, df, ddf, t_new, mid;
+    
+    vdouble pos[3], vel[3], acc[3], jerk[3], d[3];
+    vdouble const tol = 1.0e-11, zero = 0.0, one = 1.0, two = 2.0;
+    
+    vmask active = vgt(one, zero), after, safe;
+    size_t itr = 0;
+    
+    while (vany(active) and itr < max_iter) {
+        vcalc_state(orb, time, pos, vel, acc, jerk);
+        niter = vselect(active, niter + one, niter);
+        itr++;
+        
+        d[0] = pos[0] - X; d[1] = pos[1] - Y; d[2] = pos[2] - Z;
+        f = vdot(vel, d);
+        
+        active = active & vgt(vabs(f), tol * vsqrt(vdot(d, d))
+                                           * vsqrt(vdot(vel, vel)));
+        
+        after = active & vgt(f, zero);
+        t_stop = vselect(after, time, t_stop);
+        t_start = vselect(vandnot(after, active), time, t_start);
+        
+        df = vdot(acc, d) + vdot(vel, vel);
+        
+        if (solver == zd_halley) {
+            ddf = vdot(jerk, d) + vdouble(3.0) * vdot(acc, vel);
+            t_new = time - two * f * df / (two * df * df - f * ddf);
+        }
+        else
+            t_new = time - f / df;
+        
+        mid = (t_start + t_stop) / two;
+        safe = vgt(t_new, t_start) & vgt(t_stop, t_new);
+        t_new = vselect(safe, t_new, mid);
+        
+        time = vselect(active, t_new, time);
+    }
+    
+    vcalc_pos(orb, time, sat_x, sat_y, sat_z);
+    t_zd = time;
+} // vclosest_appr_newton
+
+
+// topo_angles on SIMD lanes, acos and atan from fastmath.hh
+static inline void vtopo_angles(vdouble const xl, vdouble const yl,
+                                vdouble const zl, vdouble const t0,
+                                vdouble& azi, vdouble& inc)
+{
+    vdouble const zero = 0.0, vpi = pi, half_circle = 180.0;
+    vdouble _xl, temp_azi;
+    
+    inc = vacos(zl / t0) * vdouble(rad2deg);
+    
+    vmask is_zero = vandnot(vgt(xl, zero), vandnot(vgt(zero, xl), vtrue()));
+    _xl = vselect(is_zero, vdouble(0.000000001), xl);
+    
+    temp_azi = vatan(vabs(yl / _xl));
+    
+    vmask west = vgt(zero, _xl), east = vgt(_xl, zero),
+          north = vgt(yl, zero), south = vgt(zero, yl);
+    
+    temp_azi = vselect(west & north, vpi - temp_azi, temp_azi);
+    temp_azi = vselect(west & south, vpi + temp_azi, temp_azi);
+    temp_azi = vselect(east & south, vdouble(2.0 * pi) - temp_azi, temp_azi);
+    
+    temp_azi = temp_azi * vdouble(rad2deg);
+    
+    azi = vselect(vgt(temp_azi, half_circle), temp_azi - half_circle,
+                  temp_azi + half_circle);
+} // vtopo_angles
+
+
+template<class Orbit>
+static inline void azi_inc_block(Orbit const& orb, point_block& blk,
+                                 zd_params const& par)
+{
+    vdouble X = vload(blk.X), Y = vload(blk.Y), Z = vload(blk.Z),
+            slat = vload(blk.slat), clat = vload(blk.clat),
+            slon = vload(blk.slon), clon = vload(blk.clon),
+            seed = vload(blk.seed), sat_x, sat_y, sat_z, xf, yf, zf,
+            xl, yl, zl, t0, t_zd, niter = 0.0;
+    
+    vdouble const t_min = orb.start_t - 5.0, t_max = orb.stop_t + 5.0,
+                  mid = (t_min + t_max) / vdouble(2.0);
+    
+    double _xl[SIMD_WIDTH], _yl[SIMD_WIDTH], _zl[SIMD_WIDTH], _t0[SIMD_WIDTH];
+    
+    // seed inside the orbit window
+    vmask warm = vandnot(vgt(t_min, seed), vandnot(vgt(seed, t_max),
+                                                   vgt(t_max, t_min)));
+    seed = vselect(warm, seed, mid);
+    
+    if (par.solver == zd_bisect) {
+        vdouble t_start = t_min, t_stop = t_max, dot_start = 0.0;
+        
+        vbracket(orb, X, Y, Z, warm, seed, t_start, t_stop, dot_start, niter);
+        vclosest_appr(orb, X, Y, Z, par.max_iter, t_start, t_stop, dot_start,
+                      sat_x, sat_y, sat_z, t_zd, niter);
+    }
+    else
+        vclosest_appr_newton(orb, X, Y, Z, par.max_iter, par.solver, t_min,
+                             t_max, seed, sat_x, sat_y, sat_z, t_zd, niter);
+    
+    vstore(blk.seed, t_zd);
+    vstore(blk.niter, niter);
+    
+    xf = sat_x - X;
+    yf = sat_y - Y;
+    zf = sat_z - Z;
+    
+    // same operations as _azi_inc
+    if (par.output == go_radar) {
+        vdouble pos[3], vel[3];
+        
+        vcalc_pos_vel(orb, t_zd, pos, vel);
+        
+        vstore(blk.out[0], t_zd);
+        vstore(blk.out[1], vsqrt(xf * xf + yf * yf + zf * zf));
+        vstore(blk.out[2], sat_x);
+        vstore(blk.out[3], sat_y);
+        vstore(blk.out[4], sat_z);
+        
+        FOR(jj, 3)
+            vstore(blk.out[5 + jj], vel[jj]);
+        
+        return;
+    }
+    
+    xl = - slat * clon * xf - slat * slon * yf + clat * zf;
+    yl = - slon * xf + clon * yf;
+    zl = clat * clon * xf + clat * slon * yf + slat * zf;
+    
+    t0 = vsqrt(xl * xl + yl * yl + zl * zl);
+    
+    // same operations as topo_output
+    if (par.output == go_los or par.output == go_los_range) {
+        vstore(blk.out[0], yl / t0);
+        vstore(blk.out[1], xl / t0);
+        vstore(blk.out[2], zl / t0);
+        vstore(blk.out[3], t0);
+        return;
+    }
+    
+    vstore(blk.out[2], t0);
+    
+    if (par.fast_math) {
+        vdouble azi, inc;
+        
+        vtopo_angles(xl, yl, zl, t0, azi, inc);
+        vstore(blk.out[0], azi); vstore(blk.out[1], inc);
+        return;
+    }
+    
+    vstore(_xl, xl); vstore(_yl, yl); vstore(_zl, zl); vstore(_t0, t0);
+    
+    // acos and atan are left to libm
+    FOR(ii, SIMD_WIDTH)
+        topo_angles(_xl[ii], _yl[ii], _zl[ii], _t0[ii], blk.out[0][ii],
+                    blk.out[1][ii]);
+} // azi_inc_block
+
+
+static inline void load_point(real_view const& coords, size_t const idx,
+                              bool const is_lonlat, double& X, double& Y,
+                              double& Z, double& lon, double& lat)
+{
+    double h;
+    
+    if (is_lonlat) {
+        // coords contains lon, lat, h
+        lon = coords(idx, 0) * deg2rad;
+        lat = coords(idx, 1) * deg2rad;
+        h   = coords(idx, 2);
+        
+        // calulate surface WGS-84 Cartesian coordinates
+        ell_cart(lon, lat, h, X, Y, Z);
+    } else {
+        // coords contains X, Y, Z
+        X = coords(idx, 0);
+        Y = coords(idx, 1);
+        Z = coords(idx, 2);
+        
+        // calulate surface WGS-84 geodetic coordinates
+        cart_ell(X, Y, Z, lon, lat, h);
+    }
+} // load_point
+
+
+/* Bowring's formula, as in cart_ell, but the sine and cosine of the
+ * parametric and geodetic latitudes are computed from their tangents,
+ * sin(atan(t)) = t / sqrt(1 + t^2), and the height is taken along the
+ * normal, so only atan and atan2 are left to libm. Returns the tangent of
+ * the latitude. Undefined on the polar axis. */
+static inline vdouble vcart_ell_fast(vdouble const x, vdouble const y,
+                                     vdouble const z, vdouble& h)
+{
+    vdouble const one = 1.0, a = WA, b = WB, n = WA * WA - WB * WB;
+    vdouble p, t, c, s, tlat;
+    
+    p = vsqrt(x * x + y * y);
+    
+    // parametric latitude
+    t = a / p / b * z;
+    c = one / vsqrt(one + t * t);
+    s = t * c;
+    
+    tlat = (z + n / b * s * s * s) / (p - n / a * c * c * c);
+    
+    // geodetic latitude
+    c = one / vsqrt(one + tlat * tlat);
+    s = tlat * c;
+    
+    h = p * c + z * s - a * vsqrt(one - vdouble(E2) * s * s);
+    
+    return tlat;
+} // vcart_ell_fast
+
+
+/* Geodetic and Cartesian coordinates of the points of blk for fast_math.
+ * On input blk.X, blk.Y, blk.Z hold the rows of coords. For lon, lat
+ * [rad], h the trigonometric functions come from vsincos, for X, Y, Z
+ * from the tangent of the latitude returned by vcart_ell_fast. */
+static inline void fast_load_block(point_block& blk, bool const is_lonlat)
+{
+    vdouble const one = 1.0;
+    vdouble slat, clat, slon, clon;
+    
+    if (is_lonlat) {
+        vdouble h = vload(blk.Z), n;
+        
+        vsincos(vload(blk.X), slon, clon);
+        vsincos(vload(blk.Y), slat, clat);
+        
+        // same operations as ell_cart
+        n = vdouble(WA) / vsqrt(one - vdouble(E2) * slat * slat);
+        
+        vstore(blk.X, (n + h) * clat * clon);
+        vstore(blk.Y, (n + h) * clat * slon);
+        vstore(blk.Z, (vdouble(1.0 - E2) * n + h) * slat);
+    } else {
+        vdouble X = vload(blk.X), Y = vload(blk.Y), h, p, tlat;
+        
+        tlat = vcart_ell_fast(X, Y, vload(blk.Z), h);
+        p = vsqrt(X * X + Y * Y);
+        
+        clat = one / vsqrt(one + tlat * tlat);
+        slat = tlat * clat;
+        slon = Y / p;
+        clon = X / p;
+    }
+    
+    vstore(blk.slat, slat); vstore(blk.clat, clat);
+    vstore(blk.slon, slon); vstore(blk.clon, clon);
+} // fast_load_block
+
+
+// loads the rows idx[0...SIMD_WIDTH - 1] of coords into blk
+static inline void load_block(real_view const& coords, size_t const *idx,
+                              bool const is_lonlat, bool const fast_math,
+                              point_block& blk)
+{
+    double X, Y, Z, lon, lat;
+    
+    FOR(jj, SIMD_WIDTH) {
+        if (fast_math) {
+            double scale = is_lonlat ? deg2rad : 1.0;
+            
+            blk.X[jj] = coords(idx[jj], 0) * scale;
+            blk.Y[jj] = coords(idx[jj], 1) * scale;
+            blk.Z[jj] = coords(idx[jj], 2);
+        } else {
+            load_point(coords, idx[jj], is_lonlat, X, Y, Z, lon, lat);
+            
+            blk.X[jj] = X; blk.Y[jj] = Y; blk.Z[jj] = Z;
+            blk.slat[jj] = sin(lat); blk.clat[jj] = cos(lat);
+            blk.slon[jj] = sin(lon); blk.clon[jj] = cos(lon);
+        }
+    }
+    
+    if (fast_math)
+        fast_load_block(blk, is_lonlat);
+} // load_block
+
+
+struct track_key {
+    double key;
+    size_t idx;
+};
+
+
+static int cmp_track_key(void const* _a, void const* _b)
+{
+    track_key const *a = (track_key const*) _a, *b = (track_key const*) _b;
+    
+    if (a->key != b->key)
+        return a->key < b->key ? -1 : 1;
+    
+    return a->idx < b->idx ? -1 : (a->idx > b->idx);
+}
+
+
+/* Order of the points along the track: projection of their position onto
+ * the satellite velocity at the middle of the orbit window. Zero-Doppler
+ * times increase (nearly) monotonically in this order. */
+template<class Orbit>
+static bool along_track_order(Orbit const& orb, real_view const& coords,
+                              bool const is_lonlat, size_t* order, Pool& pool)
+{
+    size_t nrows = coords.shape[0];
+    double X, Y, Z;
+    cart pos, vel, acc, jerk;
+    pool_scope scope(pool);
+    track_key *keys;
+    
+    if ((keys = palloc(pool, track_key, nrows)) == NULL)
+        return true;
+    
+    calc_state(orb, (orb.start_t + orb.stop_t) / 2.0, pos, vel, acc, jerk);
+    
+    FOR(ii, nrows) {
+        if (is_lonlat) {
+            ell_cart(coords(ii, 0) * deg2rad, coords(ii, 1) * deg2rad,
+                     coords(ii, 2), X, Y, Z);
+        } else {
+            X = coords(ii, 0);
+            Y = coords(ii, 1);
+            Z = coords(ii, 2);
+        }
+        
+        keys[ii].key = vel.x * X + vel.y * Y + vel.z * Z;
+        keys[ii].idx = ii;
+    }
+    
+    qsort(keys, nrows, sizeof(track_key), cmp_track_key);
+    
+    FOR(ii, nrows)
+        order[ii] = keys[ii].idx;
+    
+    return false;
+} // along_track_order
+
+
+template<class Orbit>
+struct azi_inc_job {
+    Orbit const *orb;
+    real_view const *coords;
+    real_view *azi_inc;
+    zd_params const *par;
+    view<int> *niter;
+    size_t const *order;
+    size_t nrows;
+    bool is_lonlat;
+};
+
+
+// process rows [begin, end), begin is a multiple of SIMD_WIDTH
+template<class Orbit>
+static void azi_inc_rows(azi_inc_job<Orbit> const& job, size_t const begin,
+                         size_t const end)
+{
+    Orbit const& orb = *job.orb;
+    real_view const& coords = *job.coords;
+    real_view& azi_inc = *job.azi_inc;
+    zd_params const& par = *job.par;
+    size_t const *order = job.order, ncols = geom_ncols(par.output);
+    
+    double X, Y, Z, lon, lat, t_zd = HUGE_VAL, out[max_geom_ncols];
+    X = Y = Z = lon = lat = 0.0;
+    
+    size_t nblock = end - (end - begin) % SIMD_WIDTH, idx[SIMD_WIDTH];
+    
+    // with fast_math the last block is padded with the last row instead
+    if (par.fast_math and nblock < end)
+        nblock += SIMD_WIDTH;
+    
+    point_block blk;
+    
+    // no seed for the first block
+    FOR(jj, SIMD_WIDTH)
+        blk.seed[jj] = HUGE_VAL;
+    
+    // full blocks of SIMD_WIDTH points
+    FORS(ii, begin, nblock, SIMD_WIDTH) {
+        FOR(jj, SIMD_WIDTH) {
+            size_t kk = ii + jj < end ? ii + jj : end - 1;
+            
+            idx[jj] = order != NULL ? order[kk] : kk;
+            
+            if (par.seed == zd_cold)
+                blk.seed[jj] = HUGE_VAL;
+        }
+        
+        load_block(coords, idx, job.is_lonlat, par.fast_math, blk);
+        
+        azi_inc_block(orb, blk, par);
+        
+        // padding lanes repeat the last row, the real one is stored last
+        FOR(jj, SIMD_WIDTH) {
+            FOR(kk, ncols)
+                azi_inc.set(idx[jj], kk, blk.out[kk][jj]);
+        }
+        
+        if (job.niter != NULL) {
+            FOR(jj, SIMD_WIDTH)
+                (*job.niter)(idx[jj]) = int(blk.niter[jj]);
+        }
+    }
+    
+    if (par.seed != zd_cold and nblock > begin)
+        t_zd = blk.seed[SIMD_WIDTH - 1];
+    
+    // scalar tail
+    FOR1(ii, nblock, end) {
+        size_t jj = order != NULL ? order[ii] : ii;
+        
+        load_point(coords, jj, job.is_lonlat, X, Y, Z, lon, lat);
+        
+        if (par.seed == zd_cold)
+            t_zd = HUGE_VAL;
+        
+        size_t itr = _azi_inc(orb, X, Y, Z, lon, lat, par, t_zd, out);
+        
+        FOR(kk, ncols)
+            azi_inc.set(jj, kk, out[kk]);
+        
+        if (job.niter != NULL)
+            (*job.niter)(jj) = int(itr);
+    }
+} // azi_inc_rows
+
+
+// work function of parallel_for, processes segments [begin, end)
+template<class Orbit>
+static void azi_inc_worker(void *ctx, size_t const begin, size_t const end)
+{
+    azi_inc_job<Orbit> const& job = *((azi_inc_job<Orbit> const*) ctx);
+    
+    FOR1(ii, begin, end) {
+        size_t first = ii * azi_inc_segment,
+               last = first + azi_inc_segment;
+        
+        azi_inc_rows(job, first, last < job.nrows ? last : job.nrows);
+    }
+}
+
+
+template<class Orbit>
+static bool azi_inc_all(Orbit const& orb, real_view const& coords,
+                        real_view& azi_inc, zd_params const& par,
+                        bool const is_lonlat, view<int>* niter)
+{
+    size_t nrows = coords.shape[0], *order = NULL;
+    
+    // order and the sort keys of along_track_order
+    Pool pool(2, nrows * sizeof(size_t), nrows * sizeof(track_key));
+    
+    if (par.seed == zd_warm_sort) {
+        if (pool.init() or (order = palloc(pool, size_t, nrows)) == NULL)
+            return true;
+        
+        if (along_track_order(orb, coords, is_lonlat, order, pool))
+            return true;
+    }
+    
+    azi_inc_job<Orbit> job;
+    
+    job.orb = &orb;
+    job.coords = &coords;
+    job.azi_inc = &azi_inc;
+    job.par = &par;
+    job.niter = niter;
+    job.order = order;
+    job.nrows = nrows;
+    job.is_lonlat = is_lonlat;
+    
+    parallel_for((nrows + azi_inc_segment - 1) / azi_inc_segment,
+                 par.nthreads, azi_inc_worker<Orbit>, &job);
+    
+    return false;
+} // azi_inc_all
+
+
+// arguments of azi_inc_all for orbit_dispatch
+struct azi_inc_kernel {
+    fit_poly const& orb;
+    real_view const& coords;
+    real_view& azi_inc;
+    zd_params const& par;
+    bool is_lonlat;
+    view<int>* niter;
+    
+    azi_inc_kernel(fit_poly const& orb, real_view const& coords,
+                   real_view& azi_inc, zd_params const& par,
+                   bool const is_lonlat, view<int>* niter):
+                   orb(orb), coords(coords), azi_inc(azi_inc), par(par),
+                   is_lonlat(is_lonlat), niter(niter) {};
+    
+    template<class Orbit>
+    bool run() const {
+        return azi_inc_all(Orbit(orb), coords, azi_inc, par, is_lonlat,
+                           niter);
+    }
+};
+
+
+bool calc_azi_inc(const fit_poly& orb, real_view const& coords,
+                  real_view& azi_inc, zd_params const& par,
+                  bool const is_lonlat, view<int>* niter)
+{
+    return orbit_dispatch(orb.basis, orb.deg,
+                          azi_inc_kernel(orb, coords, azi_inc, par, is_lonlat,
+                                         niter));
+}
+
+
+/***********************************
+ * Many orbits, the same point set *
+ ***********************************/
+
+/* The points are converted into a point_cache once. Then they are processed
+ * in tiles of multi_tile points, every tile is run against all orbits
+ * before moving to the next one, so its coordinates stay in cache. Warm
+ * start seeds do not cross tiles, threads receive whole tiles (whole
+ * tile - date pairs in calc_azi_inc_dates). */
+static const size_t multi_tile = 512;   // a multiple of SIMD_WIDTH
+
+// SoA copy of the point_block fields of the points, padded to SIMD_WIDTH
+struct point_cache {
+    double *X, *Y, *Z, *slat, *clat, *slon, *clon;
+    size_t const *order;
+    size_t npoint;
+};
+
+
+struct cache_job {
+    view<double> const *coords;
+    point_cache *cache;
+    bool is_lonlat, fast_math;
+};
+
+
+// work function of parallel_for, fills tiles [begin, end) of the cache
+static void cache_worker(void *ctx, size_t const begin, size_t const end)
+{
+    cache_job const& job = *((cache_job const*) ctx);
+    point_cache& cache = *job.cache;
+    size_t const npoint = cache.npoint;
+    
+    size_t idx[SIMD_WIDTH];
+    point_block blk;
+    
+    FORS(ii, begin * multi_tile, end * multi_tile, SIMD_WIDTH) {
+        if (ii >= npoint)
+            break;
+        
+        // the last block is padded with the last point
+        FOR(jj, SIMD_WIDTH) {
+            size_t kk = ii + jj < npoint ? ii + jj : npoint - 1;
+            idx[jj] = cache.order != NULL ? cache.order[kk] : kk;
+        }
+        
+        load_block(*job.coords, idx, job.is_lonlat, job.fast_math, blk);
+        
+        FOR(jj, SIMD_WIDTH) {
+            cache.X[ii + jj] = blk.X[jj];
+            cache.Y[ii + jj] = blk.Y[jj];
+            cache.Z[ii + jj] = blk.Z[jj];
+            cache.slat[ii + jj] = blk.slat[jj];
+            cache.clat[ii + jj] = blk.clat[jj];
+            cache.slon[ii + jj] = blk.slon[jj];
+            cache.clon[ii + jj] = blk.clon[jj];
+        }
+    }
+} // cache_worker
+
+
+// orbit ii of an orbit_stack
+struct stack_orbit {
+    double mean_coords[3];
+    size_t shape[2], strides[2];
+    view<double> coeffs;
+    fit_poly fit;
+    
+    stack_orbit(orbit_stack const& orbs, size_t const ii):
+        coeffs(orbs.coeffs.data + ii * orbs.coeffs.strides[0], 2, shape,
+               strides),
+        fit(orbs.mean_t(ii), orbs.start_t(ii), orbs.stop_t(ii), mean_coords,
+            coeffs, orbs.is_centered, orbs.deg, orbs.basis)
+    {
+        shape[0] = 3;
+        shape[1] = orbs.deg + 1;
+        strides[0] = orbs.coeffs.strides[1];
+        strides[1] = orbs.coeffs.strides[2];
+        
+        FOR(jj, 3)
+            mean_coords[jj] = orbs.mean_coords(ii, jj);
+    }
+};
+
+
+struct multi_job {
+    orbit_stack const *orbs;
+    point_cache const *cache;
+    view<double> *azi_inc;
+    zd_params const *par;
+    
+    // calc_azi_inc_dates: master date, zero-Doppler times of the points
+    // for it and the shifts of the seeds for the other dates
+    size_t master;
+    double *t_master, *shift;
+};
+
+
+// solves the points of tile tt for orbit oo
+template<class Orbit>
+static void tile_orbit(multi_job const& job, size_t const tt, size_t const oo)
+{
+    point_cache const& cache = *job.cache;
+    view<double>& azi_inc = *job.azi_inc;
+    zd_params const& par = *job.par;
+    size_t const npoint = cache.npoint, ncols = geom_ncols(par.output),
+                 first = tt * multi_tile;
+    size_t const last = first + multi_tile < npoint ? first + multi_tile
+                                                    : npoint;
+    
+    // seeds from the master date, except for the master date itself
+    bool const seeded = job.t_master != NULL and oo != job.master;
+    
+    stack_orbit const so(*job.orbs, oo);
+    Orbit const orb(so.fit);
+    point_block blk;
+    
+    FOR(jj, SIMD_WIDTH)
+        blk.seed[jj] = HUGE_VAL;
+    
+    FORS(ii, first, last, SIMD_WIDTH) {
+        FOR(jj, SIMD_WIDTH) {
+            blk.X[jj] = cache.X[ii + jj];
+            blk.Y[jj] = cache.Y[ii + jj];
+            blk.Z[jj] = cache.Z[ii + jj];
+            blk.slat[jj] = cache.slat[ii + jj];
+            blk.clat[jj] = cache.clat[ii + jj];
+            blk.slon[jj] = cache.slon[ii + jj];
+            blk.clon[jj] = cache.clon[ii + jj];
+            
+            if (seeded)
+                blk.seed[jj] = job.t_master[ii + jj] + job.shift[oo];
+            else if (par.seed == zd_cold)
+                blk.seed[jj] = HUGE_VAL;
+        }
+        
+        azi_inc_block(orb, blk, par);
+        
+        // blk.seed holds the zero-Doppler times now
+        if (job.t_master != NULL and oo == job.master) {
+            FOR(jj, SIMD_WIDTH)
+                job.t_master[ii + jj] = blk.seed[jj];
+        }
+        
+        FOR(jj, SIMD_WIDTH) {
+            if (ii + jj >= npoint)
+                continue;
+            
+            size_t idx = cache.order != NULL ? cache.order[ii + jj] : ii + jj;
+            
+            FOR(kk, ncols)
+                azi_inc(idx, oo, kk) = blk.out[kk][jj];
+        }
+    }
+} // tile_orbit
+
+
+// work function of parallel_for, processes tiles [begin, end)
+template<class Orbit>
+static void multi_worker(void *ctx, size_t const begin, size_t const end)
+{
+    multi_job const& job = *((multi_job const*) ctx);
+    
+    FOR1(tt, begin, end) {
+        FOR1(oo, 0, job.orbs->norb)
+            tile_orbit<Orbit>(job, tt, oo);
+    }
+}
+
+
+// work function of parallel_for, processes tiles [begin, end) of the
+// master date
+template<class Orbit>
+static void master_worker(void *ctx, size_t const begin, size_t const end)
+{
+    multi_job const& job = *((multi_job const*) ctx);
+    
+    FOR1(tt, begin, end)
+        tile_orbit<Orbit>(job, tt, job.master);
+}
+
+
+// work function of parallel_for, item kk is tile kk / norb, date kk % norb
+template<class Orbit>
+static void dates_worker(void *ctx, size_t const begin, size_t const end)
+{
+    multi_job const& job = *((multi_job const*) ctx);
+    size_t const norb = job.orbs->norb;
+    
+    FOR1(kk, begin, end) {
+        if (kk % norb != job.master)
+            tile_orbit<Orbit>(job, kk / norb, kk % norb);
+    }
+}
+
+
+/* Runs calc_azi_inc_multi (master == orbs.norb) or calc_azi_inc_dates on
+ * the converted points. */
+template<class Orbit>
+static bool azi_inc_multi_all(orbit_stack const& orbs, size_t const master,
+                              view<double> const& coords,
+                              view<double>& azi_inc, zd_params const& par,
+                              bool const is_lonlat)
+{
+    size_t const npoint = coords.shape[0], norb = orbs.norb,
+                 npad = npoint + (SIMD_WIDTH - npoint % SIMD_WIDTH) % SIMD_WIDTH,
+                 ntile = (npoint + multi_tile - 1) / multi_tile;
+    size_t *order = NULL;
+    double *buf;
+    
+    if (npoint == 0 or norb == 0)
+        return false;
+    
+    // 7 columns of point_cache, zero-Doppler times and seed shifts, order
+    // and the sort keys of along_track_order
+    Pool pool(3, (8 * npad + norb) * sizeof(double), npoint * sizeof(size_t),
+              npoint * sizeof(track_key));
+    
+    if (pool.init() or (buf = palloc(pool, double, 8 * npad + norb)) == NULL)
+        return true;
+    
+    // the first orbit (the master date) sets the order
+    if (par.seed == zd_warm_sort) {
+        if ((order = palloc(pool, size_t, npoint)) == NULL)
+            return true;
+        
+        stack_orbit const so(orbs, master < norb ? master : 0);
+        
+        if (along_track_order(Orbit(so.fit), coords, is_lonlat, order, pool))
+            return true;
+    }
+    
+    point_cache cache;
+    
+    cache.X = buf;                cache.Y = buf + npad;
+    cache.Z = buf + 2 * npad;     cache.slat = buf + 3 * npad;
+    cache.clat = buf + 4 * npad;  cache.slon = buf + 5 * npad;
+    cache.clon = buf + 6 * npad;
+    cache.order = order;
+    cache.npoint = npoint;
+    
+    cache_job cjob;
+    
+    cjob.coords = &coords;
+    cjob.cache = &cache;
+    cjob.is_lonlat = is_lonlat;
+    cjob.fast_math = par.fast_math;
+    
+    parallel_for(ntile, par.nthreads, cache_worker, &cjob);
+    
+    multi_job job;
+    
+    job.orbs = &orbs;
+    job.cache = &cache;
+    job.azi_inc = &azi_inc;
+    job.par = &par;
+    job.master = master;
+    job.t_master = NULL;
+    job.shift = buf + 8 * npad;
+    
+    if (master >= norb)
+        parallel_for(ntile, par.nthreads, multi_worker<Orbit>, &job);
+    else {
+        job.t_master = buf + 7 * npad;
+        
+        double const mid = (orbs.start_t(master) + orbs.stop_t(master)) / 2.0;
+        
+        FOR(oo, norb)
+            job.shift[oo] = (orbs.start_t(oo) + orbs.stop_t(oo)) / 2.0 - mid;
+        
+        parallel_for(ntile, par.nthreads, master_worker<Orbit>, &job);
+        parallel_for(ntile * norb, par.nthreads, dates_worker<Orbit>, &job);
+    }
+    
+    return false;
+} // azi_inc_multi_all
+
+
+// arguments of azi_inc_multi_all for orbit_dispatch
+struct multi_kernel {
+    orbit_stack const& orbs;
+    size_t master;
+    view<double> const& coords;
+    view<double>& azi_inc;
+    zd_params const& par;
+    bool is_lonlat;
+    
+    multi_kernel(orbit_stack const& orbs, size_t const master,
+                 view<double> const& coords, view<double>& azi_inc,
+                 zd_params const& par, bool const is_lonlat):
+                 orbs(orbs), master(master), coords(coords), azi_inc(azi_inc),
+                 par(par), is_lonlat(is_lonlat) {};
+    
+    template<class Orbit>
+    bool run() const {
+        return azi_inc_multi_all<Orbit>(orbs, master, coords, azi_inc, par,
+                                        is_lonlat);
+    }
+};
+
+
+static bool multi_dispatch(orbit_stack const& orbs, size_t const master,
+                           view<double> const& coords, view<double>& azi_inc,
+                           zd_params const& par, bool const is_lonlat)
+{
+    return orbit_dispatch(orbs.basis, orbs.deg,
+                          multi_kernel(orbs, master, coords, azi_inc, par,
+                                       is_lonlat));
+}
+
+
+bool calc_azi_inc_multi(orbit_stack const& orbs, view<double> const& coords,
+                        view<double>& azi_inc, zd_params const& par,
+                        bool const is_lonlat)
+{
+    return multi_dispatch(orbs, orbs.norb, coords, azi_inc, par, is_lonlat);
+}
+
+
+bool calc_azi_inc_dates(orbit_stack const& orbs, size_t const master,
+                        view<double> const& coords, view<double>& azi_inc,
+                        zd_params const& par, bool const is_lonlat)
+{
+    return multi_dispatch(orbs, master, coords, azi_inc, par, is_lonlat);
+}
+
+
+void calc_line_pixel(real_view const& radar, real_view& line_pixel,
+                     sar_params const& sar)
+{
+    // pixels per meter of slant range, two way travel time
+    double const pix_per_m = 2.0 * sar.rsr / c_light;
+    
+    FOR(ii, radar.shape[0]) {
+        line_pixel.set(ii, 0, (radar(ii, 0) - sar.t_first) * sar.prf);
+        line_pixel.set(ii, 1, (radar(ii, 1) - sar.near_range) * pix_per_m);
+    }
+} // calc_line_pixel
+
+
+/****************************************************
+ * Interpolation from a lon/lat/height lookup table *
+ ****************************************************/
+
+struct lut_grid {
+    double min[3], step[3];
+    size_t num[3];
+    double const *azi_inc;  // (num[0] * num[1] * num[2], 2), lon fastest
+};
+
+
+// geodetic coordinates (lon [deg], lat [deg], h [m]) of a point
+static inline void geodetic(real_view const& coords, size_t const idx,
+                            bool const is_lonlat, double ell[3])
+{
+    if (is_lonlat) {
+        FOR(jj, 3)
+            ell[jj] = coords(idx, jj);
+    } else {
+        cart_ell(coords(idx, 0), coords(idx, 1), coords(idx, 2),
+                 ell[0], ell[1], ell[2]);
+        ell[0] *= rad2deg;
+        ell[1] *= rad2deg;
+    }
+}
+
+
+// wraps an azimuth difference into [-180, 180)
+static inline double azi_diff(double const diff)
+{
+    if (diff >= 180.0)
+        return diff - 360.0;
+    if (diff < -180.0)
+        return diff + 360.0;
+    return diff;
+}
+
+
+// trilinear interpolation of azimuth and incidence at ell
+static inline void lut_interp(lut_grid const& grid, double const ell[3],
+                              double& azi, double& inc)
+{
+    size_t idx[3];
+    double w[3];
+    
+    FOR(jj, 3) {
+        double pos = (ell[jj] - grid.min[jj]) / grid.step[jj];
+        
+        // clamp to the grid, extrapolates linearly from the border cells
+        if (pos < 0.0)
+            idx[jj] = 0;
+        else if (pos > double(grid.num[jj] - 2))
+            idx[jj] = grid.num[jj] - 2;
+        else
+            idx[jj] = size_t(pos);
+        
+        w[jj] = pos - double(idx[jj]);
+    }
+    
+    double const *ai = grid.azi_inc;
+    size_t const nlon = grid.num[0], nlonlat = grid.num[0] * grid.num[1],
+                 base = idx[0] + idx[1] * nlon + idx[2] * nlonlat;
+    
+    double azi_ref = ai[2 * base], dazi = 0.0, _inc = 0.0;
+    
+    FOR(kk, 8) {
+        size_t ii = kk & 1, jj = (kk >> 1) & 1, ll = (kk >> 2) & 1,
+               node = base + ii + jj * nlon + ll * nlonlat;
+        
+        double weight = (ii ? w[0] : 1.0 - w[0])
+                      * (jj ? w[1] : 1.0 - w[1])
+                      * (ll ? w[2] : 1.0 - w[2]);
+        
+        dazi += weight * azi_diff(ai[2 * node] - azi_ref);
+        _inc += weight * ai[2 * node + 1];
+    }
+    
+    azi = azi_ref + dazi;
+    
+    if (azi >= 360.0)
+        azi -= 360.0;
+    else if (azi < 0.0)
+        azi += 360.0;
+    
+    inc = _inc;
+}
+
+
+struct lut_job {
+    lut_grid const *grid;
+    real_view const *coords;
+    real_view *azi_inc;
+    bool is_lonlat;
+};
+
+
+// true if lon, lat and h are all finite
+static inline bool finite_ell(double const ell[3])
+{
+    return isfinite(ell[0]) and isfinite(ell[1]) and isfinite(ell[2]);
+}
+
+
+static void lut_worker(void *ctx, size_t const begin, size_t const end)
+{
+    lut_job const& job = *((lut_job const*) ctx);
+    real_view& azi_inc = *job.azi_inc;
+    double ell[3], azi, inc;
+    
+    FOR1(ii, begin, end) {
+        geodetic(*job.coords, ii, job.is_lonlat, ell);
+        
+        // non-finite coordinates have no cell of the lattice
+        if (not finite_ell(ell))
+            azi = inc = NAN;
+        else
+            lut_interp(*job.grid, ell, azi, inc);
+        
+        azi_inc.set(ii, 0, azi);
+        azi_inc.set(ii, 1, inc);
+    }
+}
+
+
+lut_status calc_azi_inc_lut(const fit_poly& orb, real_view const& coords,
+                            real_view& azi_inc, zd_params const& par,
+                            bool const is_lonlat, lut_params const& lut,
+                            double lut_err[2])
+{
+    size_t nrows = coords.shape[0], nfinite = 0;
+    double ell[3], max[3];
+    lut_grid grid;
+    lut_job job;
+    
+    grid.step[0] = lut.dlon; grid.step[1] = lut.dlat; grid.step[2] = lut.dh;
+    lut_err[0] = lut_err[1] = 0.0;
+    
+    job.grid = &grid;
+    job.coords = &coords;
+    job.azi_inc = &azi_inc;
+    job.is_lonlat = is_lonlat;
+    
+    // bounding box of the finite points
+    FORZ(ii, nrows) {
+        geodetic(coords, ii, is_lonlat, ell);
+        
+        if (not finite_ell(ell))
+            continue;
+        
+        if (nfinite++ == 0) {
+            FOR(jj, 3)
+                grid.min[jj] = max[jj] = ell[jj];
+        }
+        
+        FOR(jj, 3) {
+            if (ell[jj] < grid.min[jj]) grid.min[jj] = ell[jj];
+            if (ell[jj] > max[jj]) max[jj] = ell[jj];
+        }
+    }
+    
+    // nothing to interpolate, every point receives NaN
+    if (nfinite == 0) {
+        parallel_for(nrows, par.nthreads, lut_worker, &job);
+        return lut_ok;
+    }
+    
+    // at least two nodes (one cell) along every axis, counted in double so
+    // that tiny steps or huge extents do not overflow
+    double num[3], dnode = 1.0;
+    
+    FOR(jj, 3) {
+        num[jj] = floor((max[jj] - grid.min[jj]) / grid.step[jj]) + 2.0;
+        dnode *= num[jj];
+    }
+    
+    if (not (dnode <= double(lut_max_node)))
+        return lut_too_large;
+    
+    FOR(jj, 3)
+        grid.num[jj] = size_t(num[jj]);
+    
+    size_t const nnode = grid.num[0] * grid.num[1] * grid.num[2],
+                 ncell = (grid.num[0] - 1) * (grid.num[1] - 1)
+                       * (grid.num[2] - 1);
+    
+    // node coordinates are followed by cell center coordinates
+    size_t nsolve = nnode + ncell, shape[2] = {nsolve, 3},
+           strides[2] = {3, 1}, ai_shape[2] = {nsolve, 2},
+           ai_strides[2] = {2, 1};
+    
+    Pool pool(2, 3 * nsolve * sizeof(double), 2 * nsolve * sizeof(double));
+    double *nodes, *solved;
+    
+    if (pool.init() or (nodes = palloc(pool, double, 3 * nsolve)) == NULL
+        or (solved = palloc(pool, double, 2 * nsolve)) == NULL)
+        return lut_no_memory;
+    
+    size_t kk = 0;
+    
+    FOR1(ll, 0, grid.num[2]) {
+        FOR1(jj, 0, grid.num[1]) {
+            FOR1(ii, 0, grid.num[0]) {
+                nodes[3 * kk]     = grid.min[0] + double(ii) * grid.step[0];
+                nodes[3 * kk + 1] = grid.min[1] + double(jj) * grid.step[1];
+                nodes[3 * kk + 2] = grid.min[2] + double(ll) * grid.step[2];
+                kk++;
+            }
+        }
+    }
+    
+    FOR1(ll, 0, grid.num[2] - 1) {
+        FOR1(jj, 0, grid.num[1] - 1) {
+            FOR1(ii, 0, grid.num[0] - 1) {
+                nodes[3 * kk]     = grid.min[0] + (ii + 0.5) * grid.step[0];
+                nodes[3 * kk + 1] = grid.min[1] + (jj + 0.5) * grid.step[1];
+                nodes[3 * kk + 2] = grid.min[2] + (ll + 0.5) * grid.step[2];
+                kk++;
+            }
+        }
+    }
+    
+    real_view _nodes(view<double>(nodes, 2, shape, strides)),
+              _solved(view<double>(solved, 2, ai_shape, ai_strides));
+    
+    // exact geometry on the lattice
+    if (calc_azi_inc(orb, _nodes, _solved, par, true))
+        return lut_no_memory;
+    
+    grid.azi_inc = solved;
+    
+    // interpolation error at the cell centers, where it is the largest
+    FOR1(ii, nnode, nsolve) {
+        double azi, inc;
+        
+        lut_interp(grid, nodes + 3 * ii, azi, inc);
+        
+        azi = fabs(azi_diff(azi - solved[2 * ii]));
+        inc = fabs(inc - solved[2 * ii + 1]);
+        
+        if (azi > lut_err[0]) lut_err[0] = azi;
+        if (inc > lut_err[1]) lut_err[1] = inc;
+    }
+    
+    parallel_for(nrows, par.nthreads, lut_worker, &job);
+    
+    return lut_ok;
+} // calc_azi_inc_lut
+
+
+/*******************************************
+ * Batched geodetic - Cartesian conversion *
+ *******************************************/
+
+struct ell_job {
+    view<double> const *in;
+    view<double> *out;
+    cart_ell_method method;
+    bool is_deg, fast_math;
+};
+
+
+static void ell_cart_worker(void *ctx, size_t const begin, size_t const end)
+{
+    ell_job const& job = *((ell_job const*) ctx);
+    view<double> const& ell = *job.in;
+    view<double>& xyz = *job.out;
+    
+    double const scale = job.is_deg ? deg2rad : 1.0;
+    double slat[SIMD_WIDTH], clat[SIMD_WIDTH], slon[SIMD_WIDTH],
+           clon[SIMD_WIDTH], h[SIMD_WIDTH], x[SIMD_WIDTH], y[SIMD_WIDTH],
+           z[SIMD_WIDTH];
+    
+    size_t nblock = end - (end - begin) % SIMD_WIDTH;
+    
+    // with fast_math the last block is padded with the last row
+    if (job.fast_math and nblock < end)
+        nblock += SIMD_WIDTH;
+    
+    FORS(ii, begin, nblock, SIMD_WIDTH) {
+        FOR(jj, SIMD_WIDTH) {
+            size_t kk = ii + jj < end ? ii + jj : end - 1;
+            
+            // lon, lat are kept in slon, slat for vsincos
+            if (job.fast_math) {
+                slon[jj] = ell(kk, 0) * scale;
+                slat[jj] = ell(kk, 1) * scale;
+            } else {
+                double lon = ell(kk, 0) * scale, lat = ell(kk, 1) * scale;
+                
+                slat[jj] = sin(lat); clat[jj] = cos(lat);
+                slon[jj] = sin(lon); clon[jj] = cos(lon);
+            }
+            
+            h[jj] = ell(kk, 2);
+        }
+        
+        vdouble s, c, sl, cl;
+        
+        if (job.fast_math) {
+            vsincos(vload(slat), s, c);
+            vsincos(vload(slon), sl, cl);
+        } else {
+            s = vload(slat); c = vload(clat);
+            sl = vload(slon); cl = vload(clon);
+        }
+        
+        // same operations as ell_cart
+        vdouble _h = vload(h),
+                n = vdouble(WA) / vsqrt(vdouble(1.0) - vdouble(E2) * s * s);
+        
+        vstore(x, (n + _h) * c * cl);
+        vstore(y, (n + _h) * c * sl);
+        vstore(z, (vdouble(1.0 - E2) * n + _h) * s);
+        
+        // the output may be the input, padding lanes are not stored
+        FOR(jj, SIMD_WIDTH) {
+            if (ii + jj >= end)
+                continue;
+            
+            xyz(ii + jj, 0) = x[jj];
+            xyz(ii + jj, 1) = y[jj];
+            xyz(ii + jj, 2) = z[jj];
+        }
+    }
+    
+    FOR1(ii, nblock, end)
+        ell_cart(ell(ii, 0) * scale, ell(ii, 1) * scale, ell(ii, 2),
+                 xyz(ii, 0), xyz(ii, 1), xyz(ii, 2));
+} // ell_cart_worker
+
+
+/* Closed form solution of Vermeille, H. (2002) Direct transformation from
+ * geocentric coordinates to geodetic coordinates, Journal of Geodesy 76,
+ * 451-454. Exact up to rounding for points outside of a ~43 km radius
+ * sphere around the center of the Earth, poles included. */
+static inline void cart_ell_exact(cdouble x, cdouble y, cdouble z,
+                                  double& lon, double& lat, double& h)
+{
+    double const e4 = E2 * E2, a2 = WA * WA, r_xy = sqrt(x * x + y * y);
+    double p, q, r, s, t, u, v, w, k, d, dz;
+    
+    p = (x * x + y * y) / a2;
+    q = (1.0 - E2) / a2 * z * z;
+    r = (p + q - e4) / 6.0;
+    s = e4 * p * q / (4.0 * r * r * r);
+    t = cbrt(1.0 + s + sqrt(s * (2.0 + s)));
+    u = r * (1.0 + t + 1.0 / t);
+    v = sqrt(u * u + e4 * q);
+    w = E2 * (u + v - q) / (2.0 * v);
+    k = sqrt(u + v + w * w) - w;
+    d = k * r_xy / (k + E2);
+    dz = sqrt(d * d + z * z);
+    
+    lon = atan2(y, x);
+    lat = 2.0 * atan2(z, d + dz);
+    h = (k + E2 - 1.0) / k * dz;
+} // cart_ell_exact
+
+
+static void cart_ell_worker(void *ctx, size_t const begin, size_t const end)
+{
+    ell_job const& job = *((ell_job const*) ctx);
+    view<double> const& xyz = *job.in;
+    view<double>& ell = *job.out;
+    
+    double const scale = job.is_deg ? rad2deg : 1.0;
+    double lon, lat, h;
+    
+    if (job.method == ce_bowring) {
+        FOR1(ii, begin, end) {
+            cart_ell(xyz(ii, 0), xyz(ii, 1), xyz(ii, 2), lon, lat, h);
+            
+            // cart_ell returns lon in (-pi / 2, 3 pi / 2)
+            if (lon > pi)
+                lon -= 2.0 * pi;
+            
+            ell(ii, 0) = lon * scale;
+            ell(ii, 1) = lat * scale;
+            ell(ii, 2) = h;
+        }
+    }
+    else if (job.method == ce_exact) {
+        FOR1(ii, begin, end) {
+            cart_ell_exact(xyz(ii, 0), xyz(ii, 1), xyz(ii, 2), lon, lat, h);
+            
+            ell(ii, 0) = lon * scale;
+            ell(ii, 1) = lat * scale;
+            ell(ii, 2) = h;
+        }
+    }
+    else {
+        double x[SIMD_WIDTH], y[SIMD_WIDTH], z[SIMD_WIDTH], tlat[SIMD_WIDTH],
+               _h[SIMD_WIDTH];
+        vdouble vh;
+        
+        // the last block is padded with the last row
+        FORS(ii, begin, end, SIMD_WIDTH) {
+            FOR(jj, SIMD_WIDTH) {
+                size_t kk = ii + jj < end ? ii + jj : end - 1;
+                
+                x[jj] = xyz(kk, 0);
+                y[jj] = xyz(kk, 1);
+                z[jj] = xyz(kk, 2);
+            }
+            
+            vstore(tlat, vcart_ell_fast(vload(x), vload(y), vload(z), vh));
+            vstore(_h, vh);
+            
+            FOR(jj, SIMD_WIDTH) {
+                if (ii + jj >= end)
+                    continue;
+                
+                ell(ii + jj, 0) = atan2(y[jj], x[jj]) * scale;
+                ell(ii + jj, 1) = atan(tlat[jj]) * scale;
+                ell(ii + jj, 2) = _h[jj];
+            }
+        }
+    }
+} // cart_ell_worker
+
+
+void calc_ell_cart(view<double> const& ell, view<double>& xyz,
+                   bool const is_deg, size_t const nthreads,
+                   bool const fast_math)
+{
+    ell_job job;
+    
+    job.in = &ell;
+    job.out = &xyz;
+    job.is_deg = is_deg;
+    job.fast_math = fast_math;
+    
+    parallel_for(ell.shape[0], nthreads, ell_cart_worker, &job);
+} // calc_ell_cart
+
+
+void calc_cart_ell(view<double> const& xyz, view<double>& ell,
+                   cart_ell_method const method, bool const is_deg,
+                   size_t const nthreads)
+{
+    ell_job job;
+    
+    job.in = &xyz;
+    job.out = &ell;
+    job.method = method;
+    job.is_deg = is_deg;
+    job.fast_math = false;
+    
+    parallel_for(xyz.shape[0], nthreads, cart_ell_worker, &job);
+} // calc_cart_ell
+
+
+/***********************
+ * Mercator projection *
+ ***********************/
+
+/* y = a ln(tan(pi / 4 + lat / 2) ((1 - e sin(lat)) / (1 + e sin(lat)))^(e / 2))
+ *   = a (atanh(sin(lat)) - e atanh(e sin(lat)))
+ * the second form is used with fast_math. */
+template<class Vec, class Mat>
+static void ell_merc(Vec const& lon, Vec const& lat, Mat& xy, double const lon0,
+                     double const a, double const e, bool const is_deg,
+                     bool const fast_math)
+{
+    size_t const rows = lon.shape[0];
+    double const scale = is_deg ? deg2rad : 1.0;
+    
+    FOR(ii, rows)
+        xy.set(ii, 0, a * scale * (lon(ii) - lon0));
+    
+    if (not fast_math) {
+        FOR(ii, rows) {
+            double _lat = lat(ii) * scale, sin_lat = sin(_lat);
+            double tmp = pow( (1 - e * sin_lat) / (1 + e * sin_lat) , e / 2.0);
+            
+            xy.set(ii, 1, a * log(tan(pi_per_4 + _lat / 2.0) * tmp));
+        }
+        return;
+    }
+    
+    double _lat[SIMD_WIDTH], y[SIMD_WIDTH];
+    vdouble s, c;
+    
+    // the last block is padded with the last row
+    FORS(ii, 0, rows, SIMD_WIDTH) {
+        FOR(jj, SIMD_WIDTH)
+            _lat[jj] = lat(ii + jj < rows ? ii + jj : rows - 1) * scale;
+        
+        vsincos(vload(_lat), s, c);
+        vstore(y, vdouble(a) * (vatanh(s)
+                                - vdouble(e) * vatanh(vdouble(e) * s)));
+        
+        FOR(jj, SIMD_WIDTH) {
+            if (ii + jj < rows)
+                xy.set(ii + jj, 1, y[jj]);
+        }
+    }
+} // ell_merc
+
+
+// float64 arrays with unit strides are indexed without multiplies and
+// without the float32 branch of real_view
+void calc_ell_merc(real_view const& lon, real_view const& lat,
+                   real_view& xy, double const lon0, double const a,
+                   double const e, bool const is_deg, bool const fast_math)
+{
+    if (lon.is_float or lat.is_float or xy.is_float
+        or not lon.is_contiguous() or not lat.is_contiguous()
+        or not xy.is_contiguous()) {
+        ell_merc(lon, lat, xy, lon0, a, e, is_deg, fast_math);
+        return;
+    }
+    
+    fview<double, 1, contiguous> const _lon(lon.dbl), _lat(lat.dbl);
+    fview<double, 2, contiguous> _xy(xy.dbl);
+    
+    ell_merc(_lon, _lat, _xy, lon0, a, e, is_deg, fast_math);
+} // calc_ell_merc
+
+
+/*********************
+ * Forward geocoding *
+ *********************/
+
+// bilinear interpolation of the DEM at lon, lat [deg], clamped to the
+// border cells; inside is set to false outside of the grid, NaN is
+// returned for a non-finite position
+static inline double dem_height(dem_grid const& dem, cdouble lon,
+                                cdouble lat, bool& inside)
+{
+    inside = true;
+    
+    if (dem.height == NULL)
+        return dem.h0;
+    
+    view<double> const& height = *dem.height;
+    size_t const num[2] = {height.shape[0], height.shape[1]};
+    double const pos[2] = {(lat - dem.lat_first) / dem.dlat,
+                           (lon - dem.lon_first) / dem.dlon};
+    size_t idx[2];
+    double w[2];
+    
+    if (not isfinite(pos[0]) or not isfinite(pos[1])) {
+        inside = false;
+        return NAN;
+    }
+    
+    FOR(jj, 2) {
+        if (pos[jj] < 0.0 or pos[jj] > double(num[jj] - 1))
+            inside = false;
+        
+        if (pos[jj] < 0.0)
+            idx[jj] = 0;
+        else if (pos[jj] > double(num[jj] - 2))
+            idx[jj] = num[jj] - 2;
+        else
+            idx[jj] = size_t(pos[jj]);
+        
+        w[jj] = pos[jj] - double(idx[jj]);
+        
+        if (w[jj] < 0.0)
+            w[jj] = 0.0;
+        else if (w[jj] > 1.0)
+            w[jj] = 1.0;
+    }
+    
+    size_t const ii = idx[0], jj = idx[1];
+    
+    return (1.0 - w[0]) * ((1.0 - w[1]) * height(ii, jj)
+                           + w[1] * height(ii, jj + 1))
+           + w[0] * ((1.0 - w[1]) * height(ii + 1, jj)
+                     + w[1] * height(ii + 1, jj + 1));
+} // dem_height
+
+
+// height the search for a ground point starts from, before any DEM lookup
+static inline double dem_start_height(dem_grid const& dem)
+{
+    return dem.height == NULL ? dem.h0 : 0.0;
+}
+
+
+static inline void cross(double const a[3], double const b[3], double c[3])
+{
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+
+static inline double dot(double const a[3], double const b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+
+// Newton steps allowed per intersection, step size accepted [m]
+static const size_t geocode_newton = 10;
+static const double geocode_step = 1e-6;
+
+
+/* Intersection of the range sphere around sat, the plane through sat
+ * perpendicular to vel and the ellipsoid inflated by h_eff, xyz holds the
+ * starting point. Returns true if the iteration does not converge. */
+static inline bool intersect(double const sat[3], double const vel[3],
+                             cdouble rng, cdouble h_eff, double xyz[3])
+{
+    double const a2 = (WA + h_eff) * (WA + h_eff),
+                 b2 = (WB + h_eff) * (WB + h_eff);
+    double d[3], grad[3], f[3], c0[3], c1[3], c2[3], det;
+    
+    FOR(ii, geocode_newton) {
+        FOR(jj, 3)
+            d[jj] = xyz[jj] - sat[jj];
+        
+        f[0] = dot(vel, d);
+        f[1] = 0.5 * (dot(d, d) - rng * rng);
+        f[2] = 0.5 * ((xyz[0] * xyz[0] + xyz[1] * xyz[1]) / a2
+                      + xyz[2] * xyz[2] / b2 - 1.0);
+        
+        grad[0] = xyz[0] / a2;
+        grad[1] = xyz[1] / a2;
+        grad[2] = xyz[2] / b2;
+        
+        // rows of the Jacobian are vel, d and grad (Cramer's rule)
+        cross(d, grad, c0);
+        cross(grad, vel, c1);
+        cross(vel, d, c2);
+        
+        if ((det = dot(vel, c0)) == 0.0)
+            return true;
+        
+        double step = 0.0;
+        
+        FOR(jj, 3) {
+            double delta = -(f[0] * c0[jj] + f[1] * c1[jj] + f[2] * c2[jj])
+                           / det;
+            xyz[jj] += delta;
+            step += delta * delta;
+        }
+        
+        if (step < geocode_step * geocode_step)
+            return false;
+    }
+    
+    return true;
+} // intersect
+
+
+/* Ground point of zero-Doppler time t and slant range rng, lon, lat [deg].
+ * With warm xyz and h_eff hold the solution of a neighbouring pixel, they
+ * are updated. Without it (first pixel of a row, or the previous one was
+ * not found) the search restarts from dem_start_height and a first guess
+ * of xyz. Returns false if the point is not found. */
+template<class Orbit>
+static inline bool geocode_point(Orbit const& orb, cdouble t, cdouble rng,
+                                 dem_grid const& dem,
+                                 geocode_params const& par, bool const warm,
+                                 double xyz[3], double& h_eff, double ell[3])
+{
+    double sat[3], vel[3], lon, lat, h;
+    bool inside;
+    
+    calc_pos_vel(orb, t, sat, vel);
+    
+    if (not warm) {
+        // law of cosines on a sphere with the radius of the ellipsoid
+        // below the satellite, looking perpendicular to the track
+        double const r_sat = norm(sat[0], sat[1], sat[2]),
+                     sin_phi = sat[2] / r_sat,
+                     cos2_phi = 1.0 - sin_phi * sin_phi;
+        double nadir[3], side[3];
+        
+        h_eff = dem_start_height(dem);
+        
+        double const r_earth = WA * WB / sqrt(WB * WB * cos2_phi
+                                              + WA * WA * sin_phi * sin_phi)
+                               + h_eff;
+        
+        double cos_look = (rng * rng + r_sat * r_sat - r_earth * r_earth)
+                          / (2.0 * rng * r_sat);
+        
+        if (cos_look > 1.0)
+            cos_look = 1.0;
+        
+        double const sin_look = sqrt(1.0 - cos_look * cos_look);
+        
+        FOR(jj, 3)
+            nadir[jj] = -sat[jj] / r_sat;
+        
+        // x forward, z down: right is z x x
+        cross(nadir, vel, side);
+        
+        double const side_norm = (par.look_right ? 1.0 : -1.0)
+                                 / norm(side[0], side[1], side[2]);
+        
+        FOR(jj, 3)
+            xyz[jj] = sat[jj] + rng * (cos_look * nadir[jj]
+                                       + sin_look * side_norm * side[jj]);
+    }
+    
+    FOR(ii, par.max_iter) {
+        if (intersect(sat, vel, rng, h_eff, xyz))
+            return false;
+        
+        cart_ell_exact(xyz[0], xyz[1], xyz[2], lon, lat, h);
+        
+        double dh = dem_height(dem, lon * rad2deg, lat * rad2deg, inside) - h;
+        
+        if (fabs(dh) < par.tol) {
+            ell[0] = lon * rad2deg;
+            ell[1] = lat * rad2deg;
+            ell[2] = h;
+            return inside;
+        }
+        
+        h_eff += dh;
+    }
+    
+    return false;
+} // geocode_point
+
+
+template<class Orbit>
+struct geocode_job {
+    Orbit const *orb;
+    view<double> const *radar;
+    view<double> *ell;
+    raster_params const *raster;
+    sar_params const *sar;
+    dem_grid const *dem;
+    geocode_params const *par;
+    bool is_line_pixel;
+};
+
+
+template<class Orbit>
+static void geocode_worker(void *ctx, size_t const begin, size_t const end)
+{
+    geocode_job<Orbit> const& job = *((geocode_job<Orbit> const*) ctx);
+    view<double>& ell = *job.ell;
+    raster_params const& raster = *job.raster;
+    sar_params const& sar = *job.sar;
+    
+    // meters of slant range per pixel, two way travel time
+    double const m_per_pix = c_light / (2.0 * sar.rsr);
+    double xyz[3] = {0.0, 0.0, 0.0}, h_eff = dem_start_height(*job.dem),
+           out[3];
+    
+    FOR1(ii, begin, end) {
+        bool warm = false;
+        
+        FOR1(jj, 0, ell.shape[1]) {
+            double line, pixel, t, rng;
+            
+            if (job.radar == NULL) {
+                line = raster.first_line + double(ii) * raster.line_step;
+                pixel = raster.first_pixel + double(jj) * raster.pixel_step;
+            }
+            else {
+                line = (*job.radar)(ii, 0);
+                pixel = (*job.radar)(ii, 1);
+            }
+            
+            if (job.radar == NULL or job.is_line_pixel) {
+                t = sar.t_first + line / sar.prf;
+                rng = sar.near_range + pixel * m_per_pix;
+            }
+            else {
+                t = line;
+                rng = pixel;
+            }
+            
+            warm = geocode_point(*job.orb, t, rng, *job.dem, *job.par, warm,
+                                 xyz, h_eff, out);
+            
+            FOR(kk, 3)
+                ell(ii, jj, kk) = warm ? out[kk] : NAN;
+        }
+    }
+} // geocode_worker
+
+
+template<class Orbit>
+static void geocode_all(Orbit const& orb, view<double> const* radar,
+                        bool const is_line_pixel, raster_params const& raster,
+                        sar_params const& sar, dem_grid const& dem,
+                        view<double>& ell, geocode_params const& par)
+{
+    geocode_job<Orbit> job;
+    
+    job.orb = &orb;
+    job.radar = radar;
+    job.ell = &ell;
+    job.raster = &raster;
+    job.sar = &sar;
+    job.dem = &dem;
+    job.par = &par;
+    job.is_line_pixel = is_line_pixel;
+    
+    parallel_for(ell.shape[0], par.nthreads, geocode_worker<Orbit>, &job);
+}
+
+
+// arguments of geocode_all for orbit_dispatch
+struct geocode_kernel {
+    fit_poly const& orb;
+    view<double> const* radar;
+    bool is_line_pixel;
+    raster_params const& raster;
+    sar_params const& sar;
+    dem_grid const& dem;
+    view<double>& ell;
+    geocode_params const& par;
+    
+    geocode_kernel(fit_poly const& orb, view<double> const* radar,
+                   bool const is_line_pixel, raster_params const& raster,
+                   sar_params const& sar, dem_grid const& dem,
+                   view<double>& ell, geocode_params const& par):
+                   orb(orb), radar(radar), is_line_pixel(is_line_pixel),
+                   raster(raster), sar(sar), dem(dem), ell(ell), par(par) {};
+    
+    template<class Orbit>
+    bool run() const {
+        geocode_all(Orbit(orb), radar, is_line_pixel, raster, sar, dem, ell,
+                    par);
+        return false;
+    }
+};
+
+
+void calc_geocode(const fit_poly& orb, view<double> const* radar,
+                  bool const is_line_pixel, raster_params const& raster,
+                  sar_params const& sar, dem_grid const& dem,
+                  view<double>& ell, geocode_params const& par)
+{
+    orbit_dispatch(orb.basis, orb.deg,
+                   geocode_kernel(orb, radar, is_line_pixel, raster, sar, dem,
+                                  ell, par));
+}
+
+
+/*****************
+ * Owned orbits *
+ *****************/
+
+sat_orbit::sat_orbit(): fit(0.0, 0.0, 0.0, mean_coords, coeffs, 0, 0)
+{
+    mean_coords[0] = mean_coords[1] = mean_coords[2] = 0.0;
+}
+
+
+// coefficients and velocity coefficients of deg, uninitialized
+static bool alloc_coeffs(sat_orbit& orb, size_t const deg)
+{
+    size_t const n = deg + 1;
+    double *block;
+    
+    orb.pool.reset();
+    
+    if ((block = palloc(orb.pool, double, 6 * n)) == NULL)
+        return true;
+    
+    orb.shape[0] = 3;
+    orb.shape[1] = n;
+    orb.strides[0] = n;
+    orb.strides[1] = 1;
+    
+    orb.coeffs = view<double>(block, 2, orb.shape, orb.strides);
+    orb.vel_coeffs = view<double>(block + 3 * n, 2, orb.shape, orb.strides);
+    orb.fit.deg = deg;
+    
+    return false;
+}
+
+
+// velocity coefficients of basis_power orbits, as poly_orbit computes them
+static void set_vel_coeffs(sat_orbit& orb)
+{
+    size_t const deg = orb.fit.deg;
+    
+    if (orb.fit.basis != basis_power) {
+        orb.fit.vel_coeffs = NULL;
+        return;
+    }
+    
+    FOR(jj, 3) {
+        FOR(ii, deg + 1)
+            orb.vel_coeffs(jj, ii) = double(deg - ii) * orb.coeffs(jj, ii);
+    }
+    
+    orb.fit.vel_coeffs = &orb.vel_coeffs;
+}
+
+
+bool sat_orbit::init(double const mean_t, double const start_t,
+                     double const stop_t, double const mean_coords[3],
+                     view<double> const& coeffs, bool const is_centered,
+                     size_t const deg, poly_basis const basis)
+{
+    if (alloc_coeffs(*this, deg))
+        return true;
+    
+    fit.mean_t = mean_t;
+    fit.start_t = start_t;
+    fit.stop_t = stop_t;
+    fit.is_centered = is_centered;
+    fit.basis = basis;
+    
+    FOR(jj, 3) {
+        this->mean_coords[jj] = mean_coords[jj];
+        
+        FOR(ii, deg + 1)
+            this->coeffs(jj, ii) = coeffs(jj, ii);
+    }
+    
+    set_vel_coeffs(*this);
+    return false;
+}
+
+
+// num numbers separated by whitespace, returns true on failure
+static bool read_numbers(char const* str, size_t const num, double *out)
+{
+    char *end;
+    
+    FORZ(ii, num) {
+        out[ii] = strtod(str, &end);
+        
+        if (end == str)
+            return true;
+        
+        str = end;
+    }
+    
+    return false;
+}
+
+
+char const* fit_read_message(fit_read_status const status)
+{
+    switch (status) {
+        case fit_read_ok:
+            return "no error";
+        case fit_read_io:
+            return "the file could not be read";
+        case fit_read_missing:
+            return "deg, t_start or t_stop is missing";
+        case fit_read_mean:
+            return "mean_coords should hold 3 numbers";
+        case fit_read_coeffs:
+            return "coefficients should hold 3 * (deg + 1) numbers";
+        case fit_read_no_memory:
+            return "could not allocate memory for the coefficients";
+    }
+    
+    return "unknown error";
+}
+
+
+/* Lines of "key:\tvalue" as written by Satorbit.save_fit, other lines are
+ * skipped. The coefficients come from highest to lowest power, first for
+ * x then for y and z. errno tells the reason of fit_read_io. */
+fit_read_status sat_orbit::read(char const* path)
+{
+    // not File::open, which reports the failure itself
+    File file(fopen(path, "r"));
+    
+    if (file._file == NULL)
+        return fit_read_io;
+    
+    // the coefficients may come after deg
+    char line[8192], coeff_line[8192] = "", mean_line[1024] = "";
+    bool has_deg = false, has_start = false, has_stop = false,
+         is_centered = false;
+    size_t deg = 0;
+    double mean_t = 0.0;
+    
+    fit.basis = basis_power;
+    
+    while (fgets(line, sizeof(line), file._file) != NULL) {
+        char *value = strchr(line, ':');
+        
+        if (value == NULL)
+            continue;
+        
+        *value++ = '\0';
+        
+        if (str_equal(line, "centered"))
+            is_centered = atoi(value) != 0;
+        else if (str_equal(line, "deg")) {
+            deg = size_t(atoi(value));
+            has_deg = true;
+        }
+        else if (str_equal(line, "t_start")) {
+            fit.start_t = atof(value);
+            has_start = true;
+        }
+        else if (str_equal(line, "t_stop")) {
+            fit.stop_t = atof(value);
+            has_stop = true;
+        }
+        else if (str_equal(line, "mean_time"))
+            mean_t = atof(value);
+        else if (str_equal(line, "basis"))
+            fit.basis = strstr(value, "chebyshev") != NULL ? basis_chebyshev
+                                                           : basis_power;
+        else if (str_equal(line, "coefficients"))
+            strncpy(coeff_line, value, sizeof(coeff_line) - 1);
+        else if (str_equal(line, "mean_coords"))
+            strncpy(mean_line, value, sizeof(mean_line) - 1);
+    }
+    
+    if (ferror(file._file))
+        return fit_read_io;
+    
+    if (not has_deg or not has_start or not has_stop or deg == 0)
+        return fit_read_missing;
+    
+    if (is_centered and read_numbers(mean_line, 3, mean_coords))
+        return fit_read_mean;
+    
+    if (alloc_coeffs(*this, deg))
+        return fit_read_no_memory;
+    
+    if (read_numbers(coeff_line, 3 * (deg + 1), coeffs.data))
+        return fit_read_coeffs;
+    
+    if (not is_centered)
+        mean_coords[0] = mean_coords[1] = mean_coords[2] = 0.0;
+    
+    fit.mean_t = mean_t;
+    fit.is_centered = is_centered;
+    
+    set_vel_coeffs(*this);
+    return fit_read_ok;
+} // sat_orbit::read
+
+
+/* Least squares solution of A x = b, A is (nrow, ncol) column major, b
+ * (nrow, 3) column major, both are overwritten (Householder QR). x
+ * (ncol, 3) receives the solution. The columns are scaled to unit norm
+ * first as numpy.polyfit does, powers of uncentered times differ by many
+ * orders of magnitude. */
+static void lstsq(double *A, double *b, size_t const nrow, size_t const ncol,
+                  double *x, double *scale)
+{
+    FOR(kk, ncol) {
+        double *a = A + kk * nrow, norm2 = 0.0;
+        
+        FOR(ii, nrow)
+            norm2 += a[ii] * a[ii];
+        
+        scale[kk] = norm2 > 0.0 ? sqrt(norm2) : 1.0;
+        
+        FOR(ii, nrow)
+            a[ii] /= scale[kk];
+    }
+    
+    FOR1(kk, 0, ncol) {
+        double *a = A + kk * nrow, norm2 = 0.0;
+        
+        FOR1(ii, kk, nrow)
+            norm2 += a[ii] * a[ii];
+        
+        double alpha = a[kk] > 0.0 ? -sqrt(norm2) : sqrt(norm2);
+        
+        if (alpha == 0.0)
+            continue;
+        
+        // v = a[kk:] - alpha e_kk, stored in place of a[kk:]
+        a[kk] -= alpha;
+        
+        double const vnorm2 = norm2 - 2.0 * alpha * (a[kk] + alpha)
+                              + alpha * alpha;
+        
+        // reflect the remaining columns of A and the right hand sides
+        FOR1(cc, kk + 1, ncol + 3) {
+            double *c = cc < ncol ? A + cc * nrow : b + (cc - ncol) * nrow,
+                   dot = 0.0;
+            
+            FOR1(ii, kk, nrow)
+                dot += a[ii] * c[ii];
+            
+            dot *= 2.0 / vnorm2;
+            
+            FOR1(ii, kk, nrow)
+                c[ii] -= dot * a[ii];
+        }
+        
+        // diagonal of R
+        a[kk] = alpha;
+    }
+    
+    // back substitution, R is in the upper triangle of A
+    FOR(rr, 3) {
+        double const *c = b + rr * nrow;
+        
+        for(size_t kk = ncol; kk--; ) {
+            double sum = c[kk];
+            
+            FOR1(cc, kk + 1, ncol)
+                sum -= A[cc * nrow + kk] * x[cc * 3 + rr];
+            
+            x[kk * 3 + rr] = sum / A[kk * nrow + kk];
+        }
+    }
+    
+    FOR(kk, ncol) {
+        FOR(rr, 3)
+            x[kk * 3 + rr] /= scale[kk];
+    }
+} // lstsq
+
+
+bool sat_orbit::fit_state(view<double> const& time, view<double> const& pos,
+                          size_t const deg, bool const is_centered,
+                          poly_basis const basis)
+{
+    size_t const nrow = time.shape[0], ncol = deg + 1;
+    double t_start = time(0), t_stop = time(0), mean_t = 0.0;
+    
+    FOR(ii, nrow) {
+        if (time(ii) < t_start) t_start = time(ii);
+        if (time(ii) > t_stop) t_stop = time(ii);
+    }
+    
+    FOR(jj, 3)
+        mean_coords[jj] = 0.0;
+    
+    if (is_centered) {
+        FORZ(ii, nrow) {
+            mean_t += time(ii);
+            
+            FOR(jj, 3)
+                mean_coords[jj] += pos(ii, jj);
+        }
+        
+        mean_t /= double(nrow);
+        
+        FOR(jj, 3)
+            mean_coords[jj] /= double(nrow);
+    }
+    
+    Pool scratch(4, nrow * ncol * sizeof(double), 3 * nrow * sizeof(double),
+                 3 * ncol * sizeof(double), ncol * sizeof(double));
+    double *A, *b, *x, *scale;
+    
+    if (scratch.init() or (A = palloc(scratch, double, nrow * ncol)) == NULL
+        or (b = palloc(scratch, double, 3 * nrow)) == NULL
+        or (x = palloc(scratch, double, 3 * ncol)) == NULL
+        or (scale = palloc(scratch, double, ncol)) == NULL
+        or alloc_coeffs(*this, deg))
+        return true;
+    
+    FOR(ii, nrow) {
+        if (basis == basis_chebyshev) {
+            // T_0 ... T_deg of the time scaled to [-1, 1]
+            double const u = (2.0 * time(ii) - (t_start + t_stop))
+                           / (t_stop - t_start);
+            
+            A[ii] = 1.0;
+            
+            if (ncol > 1)
+                A[nrow + ii] = u;
+            
+            FOR1(kk, 2, ncol)
+                A[kk * nrow + ii] = 2.0 * u * A[(kk - 1) * nrow + ii]
+                                  - A[(kk - 2) * nrow + ii];
+        } else {
+            // (t - mean_t)^deg ... 1, as numpy.vander
+            double const t = time(ii) - mean_t;
+            
+            A[deg * nrow + ii] = 1.0;
+            
+            for(size_t kk = deg; kk--; )
+                A[kk * nrow + ii] = A[(kk + 1) * nrow + ii] * t;
+        }
+        
+        FOR(jj, 3)
+            b[jj * nrow + ii] = pos(ii, jj) - mean_coords[jj];
+    }
+    
+    lstsq(A, b, nrow, ncol, x, scale);
+    
+    FOR(jj, 3) {
+        FOR(kk, ncol)
+            coeffs(jj, kk) = x[kk * 3 + jj];
+    }
+    
+    fit.mean_t = mean_t;
+    fit.start_t = t_start;
+    fit.stop_t = t_stop;
+    fit.is_centered = is_centered;
+    fit.basis = basis;
+    
+    set_vel_coeffs(*this);
+    return false;
+} // sat_orbit::fit_state
+
+
+template<class Orbit>
+static void orbit_state_all(Orbit const& orb, view<double> const& time,
+                            view<double>* pos, view<double>* vel)
+{
+    double p[3], v[3];
+    
+    FOR(ii, time.shape[0]) {
+        calc_pos_vel(orb, time(ii), p, v);
+        
+        FOR(jj, 3) {
+            if (pos != NULL)
+                (*pos)(ii, jj) = p[jj];
+            
+            if (vel != NULL)
+                (*vel)(ii, jj) = v[jj];
+        }
+    }
+}
+
+
+void calc_orbit_state(const fit_poly& orb, view<double> const& time,
+                      view<double>* pos, view<double>* vel)
+{
+    // poly_orbit<0> computes the same as the other degrees
+    if (orb.basis == basis_chebyshev)
+        orbit_state_all(cheb_orbit(orb), time, pos, vel);
+    else
+        orbit_state_all(poly_orbit<0>(orb), time, pos, vel);
 }
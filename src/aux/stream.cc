@@ -0,0 +1,172 @@
+/* Copyright (C) 2018  István Bozsó
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "stream.hh"
+
+
+// file descriptors closed on every return path, errno is kept
+struct stream_files {
+    int in, out;
+    
+    stream_files(): in(-1), out(-1) {};
+    
+    ~stream_files() {
+        int err = errno;
+        
+        if (in >= 0)
+            close(in);
+        
+        if (out >= 0)
+            close(out);
+        
+        errno = err;
+    }
+};
+
+
+// bytes [offset, offset + len) of a file, mapped from a page boundary
+struct map_window {
+    void *base;
+    size_t len;
+    
+    map_window(): base(MAP_FAILED), len(0) {};
+    
+    ~map_window() {
+        int err = errno;
+        
+        if (base != MAP_FAILED)
+            munmap(base, len);
+        
+        errno = err;
+    }
+    
+    char * map(int const fd, size_t const offset, size_t const size,
+               bool const writable) {
+        size_t const page = size_t(sysconf(_SC_PAGESIZE)),
+                     start = offset - offset % page;
+        
+        len = size + (offset - start);
+        base = mmap(NULL, len, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                    MAP_SHARED, fd, off_t(start));
+        
+        if (base == MAP_FAILED)
+            return NULL;
+        
+        return (char*) base + (offset - start);
+    }
+};
+
+
+// float32 or float64 values at data
+static real_view rows_view(char *data, bool const is_float, size_t *shape,
+                           size_t *strides)
+{
+    if (is_float)
+        return real_view(view<float>((float*) data, 2, shape, strides));
+    
+    return real_view(view<double>((double*) data, 2, shape, strides));
+}
+
+
+static double seconds_since(timespec const& start)
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return double(now.tv_sec - start.tv_sec)
+           + 1e-9 * double(now.tv_nsec - start.tv_nsec);
+}
+
+
+stream_status calc_azi_inc_stream(const fit_poly& orb, char const* in_path,
+                                  char const* out_path, zd_params const& par,
+                                  bool const is_lonlat,
+                                  stream_params const& st, size_t& nrows)
+{
+    size_t const ncols = geom_ncols(par.output),
+                 in_row = 3 * (st.in_float ? sizeof(float) : sizeof(double)),
+                 out_row = ncols * (st.out_float ? sizeof(float)
+                                                 : sizeof(double));
+    
+    // whole segments, so chunks do not change the results
+    size_t chunk = (st.chunk_rows + azi_inc_segment - 1) / azi_inc_segment
+                   * azi_inc_segment;
+    
+    if (chunk == 0)
+        chunk = azi_inc_segment;
+    
+    stream_files files;
+    struct stat in_stat;
+    
+    nrows = 0;
+    
+    if ((files.in = open(in_path, O_RDONLY)) < 0
+        or fstat(files.in, &in_stat) < 0)
+        return ss_open_in;
+    
+    if (size_t(in_stat.st_size) % in_row)
+        return ss_size;
+    
+    nrows = size_t(in_stat.st_size) / in_row;
+    
+    if ((files.out = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0
+        or ftruncate(files.out, off_t(nrows * out_row)) < 0)
+        return ss_open_out;
+    
+    timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    for(size_t first = 0; first < nrows; first += chunk) {
+        size_t const rows = nrows - first < chunk ? nrows - first : chunk;
+        map_window in_win, out_win;
+        char *in, *out;
+        
+        if ((in = in_win.map(files.in, first * in_row, rows * in_row,
+                             false)) == NULL)
+            return ss_open_in;
+        
+        if ((out = out_win.map(files.out, first * out_row, rows * out_row,
+                               true)) == NULL)
+            return ss_open_out;
+        
+        // read once, front to back
+        madvise(in_win.base, in_win.len, MADV_SEQUENTIAL);
+        
+        size_t in_shape[2] = {rows, 3}, in_strides[2] = {3, 1},
+               out_shape[2] = {rows, ncols}, out_strides[2] = {ncols, 1};
+        
+        real_view coords = rows_view(in, st.in_float, in_shape, in_strides),
+                  azi_inc = rows_view(out, st.out_float, out_shape,
+                                      out_strides);
+        
+        if (calc_azi_inc(orb, coords, azi_inc, par, is_lonlat))
+            return ss_nomem;
+        
+        if (st.progress != NULL
+            and st.progress(st.progress_ctx, first + rows, nrows,
+                            seconds_since(start)))
+            return ss_stopped;
+    }
+    
+    return ss_ok;
+} // calc_azi_inc_stream
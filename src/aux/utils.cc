@@ -15,39 +15,97 @@
  */
 
 
+#include <errno.h>
 #include <stdarg.h>
 
-#include "Python.h"
 #include "utils.hh"
+#include "array.hh"
+#include "common_macros.hh"
 
 
+// The allocator of common_macros.hh does not need the Python runtime, so
+// kernels running with the GIL released (e.g. calc_azi_inc) can still
+// allocate.
 void *operator new(size_t num)
 {
-    return PyMem_Malloc(num);
+    return Mem_Malloc(num);
+}
+
+void *operator new[](size_t num)
+{
+    return Mem_Malloc(num);
 }
 
 void operator delete(void *ptr)
 {
-    PyMem_Free(ptr);
+    Mem_Free(ptr);
 }
 
 void operator delete[](void *ptr)
 {
-    PyMem_Free(ptr);
+    Mem_Free(ptr);
+}
+
+
+// data starts 1 to mem_align bytes into the block of Mem_Malloc, the
+// offset is stored in the byte right before it
+void *array_alloc(size_t const num_bytes)
+{
+    unsigned char *block, *data;
+    
+    if (num_bytes > size_t(-1) / 2
+        or (block = Mem_New(unsigned char, num_bytes + mem_align)) == NULL)
+        return NULL;
+    
+    data = block + mem_align - (size_t(block) & (mem_align - 1));
+    data[-1] = (unsigned char) (data - block);
+    
+    return data;
+}
+
+
+void array_free(void *ptr)
+{
+    if (ptr == NULL)
+        return;
+    
+    unsigned char *data = (unsigned char *) ptr;
+    
+    Mem_Del(data - data[-1]);
+}
+
+
+// header of the blocks of Pool, the data follows it
+struct pool_block {
+    pool_block *prev;
+    size_t size, used;
+    
+    unsigned char *data() {
+        return (unsigned char *) (this + 1);
+    }
+};
+
+
+static size_t align_up(size_t const num, size_t const align)
+{
+    return (num + align - 1) & ~(align - 1);
 }
 
 
-Pool::Pool(int num, ...)
+Pool::Pool(): head(NULL), block_size(pool_block_size), in_use(0),
+              high_water(0), reserved(0), nchained(0) {}
+
+
+Pool::Pool(int num, ...): head(NULL), block_size(0), in_use(0),
+                          high_water(0), reserved(0), nchained(0)
 {
-    storage = NULL;
-    ptr = NULL;
-    storage_size = 0;
     va_list vl;
     
     va_start(vl, num);
     
+    // every buffer may start at the next mem_align boundary
     for(int ii = 0; ii < num; ++ii)
-        storage_size += va_arg(vl, size_t);
+        block_size += align_up(va_arg(vl, size_t), mem_align);
     
     va_end(vl);
 }
@@ -55,26 +113,117 @@ Pool::Pool(int num, ...)
 
 Pool::~Pool()
 {
-    PyMem_Del(storage);
-    storage = NULL;
+    reset();
+    
+    if (head != NULL)
+        Mem_Del(head);
+    
+    head = NULL;
 }
 
 
-bool Pool::init()
+// block of at least size bytes chained after head, returns true on failure
+static bool chain_block(Pool& pool, size_t const size, size_t const align)
 {
-    if ((storage = PyMem_New(unsigned char, storage_size)) == NULL) {
-        // raise Exception
+    // room to align the start of the data
+    size_t const total = size + align;
+    pool_block *block;
+    
+    if ((block = (pool_block *) Mem_New(unsigned char,
+                                        sizeof(pool_block) + total)) == NULL)
         return true;
-    }
+    
+    block->prev = pool.head;
+    block->size = total;
+    block->used = 0;
+    
+    if (pool.head != NULL)
+        pool.nchained++;
+    
+    pool.head = block;
+    pool.reserved += total;
     
     return false;
 }
 
 
-void * Pool::alloc(size_t num_bytes)
+bool Pool::init()
 {
-    ptr += num_bytes;
-    return (void *) (ptr - num_bytes);
+    if (head != NULL)
+        return false;
+    
+    return chain_block(*this, block_size, mem_align);
+}
+
+
+void * Pool::alloc(size_t num_bytes, size_t const align)
+{
+    if (head != NULL) {
+        size_t const base = size_t(head->data()),
+                     start = align_up(base + head->used, align) - base;
+        
+        if (start + num_bytes <= head->size) {
+            in_use += start + num_bytes - head->used;
+            head->used = start + num_bytes;
+            
+            if (in_use > high_water)
+                high_water = in_use;
+            
+            return head->data() + start;
+        }
+    }
+    
+    // chained blocks grow geometrically, few of them are ever needed
+    size_t size = head != NULL ? 2 * head->size : block_size;
+    
+    if (size < num_bytes)
+        size = num_bytes;
+    
+    if (chain_block(*this, size, align))
+        return NULL;
+    
+    return alloc(num_bytes, align);
+}
+
+
+pool_mark Pool::mark() const
+{
+    pool_mark ret;
+    
+    ret.block = head;
+    ret.used = head != NULL ? head->used : 0;
+    ret.in_use = in_use;
+    
+    return ret;
+}
+
+
+void Pool::release(pool_mark const& to)
+{
+    // blocks chained after the mark are freed, the first one is kept
+    while (head != to.block and head != NULL and head->prev != NULL) {
+        pool_block *prev = head->prev;
+        
+        reserved -= head->size;
+        Mem_Del(head);
+        head = prev;
+    }
+    
+    if (head != NULL)
+        head->used = head == to.block ? to.used : 0;
+    
+    in_use = to.in_use;
+}
+
+
+void Pool::reset()
+{
+    pool_mark start;
+    
+    start.block = NULL;
+    start.used = start.in_use = 0;
+    
+    release(start);
 }
 
 
@@ -135,12 +284,48 @@ int File::write(size_t const size, size_t const num, void const* var) const {
 }
 
 
+// messages longer than this are truncated
+static const size_t log_size = 1024;
+
+static log_handler log_dest = NULL;
+
+
+void set_log_handler(log_handler handler)
+{
+    log_dest = handler;
+}
+
+
+static void vlog(bool const is_error, bool const newline, char const* fmt,
+                 va_list ap)
+{
+    char msg[log_size];
+    int len = vsnprintf(msg, log_size - 1, fmt, ap);
+    
+    if (len < 0)
+        return;
+    
+    if (size_t(len) > log_size - 2)
+        len = int(log_size - 2);
+    
+    if (newline) {
+        msg[len] = '\n';
+        msg[len + 1] = '\0';
+    }
+    
+    if (log_dest != NULL)
+        log_dest(is_error, msg);
+    else
+        fputs(msg, is_error ? stderr : stdout);
+}
+
+
 void print(char const* fmt, ...)
 {
     va_list ap;
     
     va_start(ap, fmt);
-    PySys_FormatStdout(fmt, ap);
+    vlog(false, false, fmt, ap);
     va_end(ap);
 }
 
@@ -150,7 +335,7 @@ void println(char const* fmt, ...)
     va_list ap;
     
     va_start(ap, fmt);
-    PySys_FormatStdout(fmt "\n", ap);
+    vlog(false, true, fmt, ap);
     va_end(ap);
 }
 
@@ -160,7 +345,7 @@ void error(char const* fmt, ...)
     va_list ap;
     
     va_start(ap, fmt);
-    PySys_WriteStderr(fmt, ap);
+    vlog(true, false, fmt, ap);
     va_end(ap);
 }
 
@@ -170,18 +355,19 @@ void errorln(char const* fmt, ...)
     va_list ap;
     
     va_start(ap, fmt);
-    PySys_WriteStderr(fmt "\n", ap);
+    vlog(true, true, fmt, ap);
     va_end(ap);
 }
 
 
 void perrorln(char const* perror_str, char const* fmt, ...)
 {
+    int err = errno;
     va_list ap;
     
     va_start(ap, fmt);
-    PySys_WriteStderr(fmt "\n", ap);
+    vlog(true, true, fmt, ap);
     va_end(ap);
-    perror(perror_str);
+    
+    errorln("%s: %s", perror_str, strerror(err));
 }
-
@@ -0,0 +1,65 @@
+# Copyright (C) 2018  István Bozsó
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Compiles inmet_azi_inc, the command line driver of the core library
+(no Python needed at run time), into the bin directory.
+"""
+
+from os.path import join
+from glob import iglob
+from os import remove
+from argparse import ArgumentParser, ArgumentDefaultsHelpFormatter
+from inmet.compilers import compile_project
+
+# core library, the same sources as inmet_core of setup.py
+core = [join("..", "aux", name) for name in
+        ("satorbit.cc", "utils.cc", "parallel.cc", "stream.cc")] \
+     + [join("..", "tpl_spec.cc")]
+
+def parse_args():
+    
+    ap = ArgumentParser(description=__doc__, formatter_class=
+                        ArgumentDefaultsHelpFormatter)
+    
+    ap.add_argument(
+        "--clean",
+        action="store_true",
+        help="If defined the program will clean the object files after "
+             "compilation.")
+    
+    return ap.parse_args()
+
+def main():
+
+    args = parse_args()
+    
+    # -ffp-contract=off: results bit identical to those of inmet_aux
+    flags = ["-std=c++98", "-O3", "-march=native", "-ffp-contract=off",
+             "-pthread"]
+    
+    compile_project("inmet_azi_inc.cc", *core, outdir=join("..", "..", "bin"),
+                    libs=["m", "pthread", "stdc++"], flags=flags,
+                    inc_dirs=[join("..", "include")])
+
+    if args.clean:
+        print("\nCleaning up object files.", end="\n\n")
+        
+        for obj in iglob(join("**", "*.o"), recursive=True):
+            remove(obj)
+
+
+if __name__ == "__main__":
+    main()
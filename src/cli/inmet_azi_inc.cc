@@ -0,0 +1,228 @@
+/* Copyright (C) 2018  István Bozsó
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Native counterpart of bin/azi_inc_file.py: azimuth and incidence angles
+ * (or other geometry outputs) of the points of a raw binary file, computed
+ * chunk by chunk by the core library, without starting Python. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.hh"
+#include "satorbit.hh"
+#include "stream.hh"
+
+
+static char const* usage =
+"usage: inmet_azi_inc fit_file in_path out_path [options]\n"
+"\n"
+"Azimuth and incidence angles (or other geometry outputs) of the points of\n"
+"a raw binary file, computed chunk by chunk.\n"
+"\n"
+"  fit_file             orbit polynom saved by fit_orbit.py\n"
+"  in_path              raw binary file of (lon, lat, h) or, with --xyz,\n"
+"                       (X, Y, Z) rows\n"
+"  out_path             raw binary file of the results\n"
+"\n"
+"options:\n"
+"  --xyz                input rows are WGS-84 Cartesian coordinates\n"
+"  --float32_in         input is float32 instead of float64\n"
+"  --float32_out        output is float32 instead of float64, not with radar\n"
+"  --output OUT         angles (default), los, los_range, angles_range or\n"
+"                       radar\n"
+"  --solver SOLVER      bisect (default), newton or halley\n"
+"  --warm_start SEED    off (default), sorted or sort\n"
+"  --max_iter N         iteration limit of the search (1000)\n"
+"  --nthreads N         worker threads, 0 means one per processor (1)\n"
+"  --fast_math          polynomial sin, cos, acos and atan\n"
+"  --chunk_rows N       points mapped into memory at a time (1048576)\n"
+"  --quiet              do not report progress\n";
+
+
+// index of str in names, -1 if it is not there
+static int choice(char const* str, char const* const* names, int num)
+{
+    for(int ii = 0; ii < num; ++ii)
+        if (str_equal(str, names[ii]))
+            return ii;
+    
+    return -1;
+}
+
+
+// same format as print_progress of inmet/satorbit.py, with the elapsed time
+static bool report(void *, size_t const done, size_t const total,
+                   double const elapsed)
+{
+    double const percent = total > 0 ? 100.0 * double(done) / double(total)
+                                     : 100.0,
+                 rate = elapsed > 0.0 ? double(done) / elapsed : 0.0;
+    
+    error("\r%lu / %lu points (%.1f %%), %.1f s, %.0f points/s",
+          (unsigned long) done, (unsigned long) total, percent, elapsed, rate);
+    
+    if (done == total)
+        error("\n");
+    
+    return false;
+}
+
+
+int main(int argc, char **argv)
+{
+    static char const* const outputs[] = {"angles", "los", "los_range",
+                                          "angles_range", "radar"};
+    static char const* const solvers[] = {"bisect", "newton", "halley"};
+    static char const* const seeds[] = {"off", "sorted", "sort"};
+    
+    char const* pos[3];
+    int npos = 0, output = go_angles, solver = zd_bisect, seed = zd_cold;
+    bool is_lonlat = true, float32_in = false, float32_out = false,
+         fast_math = false, quiet = false;
+    long max_iter = 1000, nthreads = 1, chunk_rows = 1 << 20;
+    
+    for(int ii = 1; ii < argc; ++ii) {
+        char const* arg = argv[ii];
+        
+        // options taking a value
+        bool has_value = str_equal(arg, "--output")
+                         or str_equal(arg, "--solver")
+                         or str_equal(arg, "--warm_start")
+                         or str_equal(arg, "--max_iter")
+                         or str_equal(arg, "--nthreads")
+                         or str_equal(arg, "--chunk_rows");
+        
+        if (has_value and ii + 1 == argc) {
+            errorln("%s needs a value!\n\n%s", arg, usage);
+            return 1;
+        }
+        
+        if (str_equal(arg, "-h") or str_equal(arg, "--help")) {
+            print("%s", usage);
+            return 0;
+        }
+        else if (str_equal(arg, "--xyz"))
+            is_lonlat = false;
+        else if (str_equal(arg, "--float32_in"))
+            float32_in = true;
+        else if (str_equal(arg, "--float32_out"))
+            float32_out = true;
+        else if (str_equal(arg, "--fast_math"))
+            fast_math = true;
+        else if (str_equal(arg, "--quiet"))
+            quiet = true;
+        else if (str_equal(arg, "--output"))
+            output = choice(argv[++ii], outputs, 5);
+        else if (str_equal(arg, "--solver"))
+            solver = choice(argv[++ii], solvers, 3);
+        else if (str_equal(arg, "--warm_start"))
+            seed = choice(argv[++ii], seeds, 3);
+        else if (str_equal(arg, "--max_iter"))
+            max_iter = atol(argv[++ii]);
+        else if (str_equal(arg, "--nthreads"))
+            nthreads = atol(argv[++ii]);
+        else if (str_equal(arg, "--chunk_rows"))
+            chunk_rows = atol(argv[++ii]);
+        else if (arg[0] == '-' and arg[1] == '-') {
+            errorln("Unknown option %s!\n\n%s", arg, usage);
+            return 1;
+        }
+        else if (npos < 3)
+            pos[npos++] = arg;
+        else {
+            errorln("Too many arguments!\n\n%s", usage);
+            return 1;
+        }
+    }
+    
+    if (npos != 3) {
+        error("%s", usage);
+        return 1;
+    }
+    
+    if (output < 0 or solver < 0 or seed < 0) {
+        errorln("Invalid choice of --output, --solver or --warm_start!");
+        return 1;
+    }
+    
+    // float32 zero-Doppler times would be off by several lines
+    if (float32_out and output == go_radar) {
+        errorln("output 4 (radar) is only available in double precision!");
+        return 1;
+    }
+    
+    if (max_iter <= 0 or nthreads < 0 or chunk_rows <= 0) {
+        errorln("--max_iter and --chunk_rows should be positive, "
+                "--nthreads non-negative!");
+        return 1;
+    }
+    
+    sat_orbit orbit;
+    fit_read_status const status = orbit.read(pos[0]);
+    
+    if (status == fit_read_io) {
+        perrorln("inmet_azi_inc", "Failed to read \"%s\"!", pos[0]);
+        return 1;
+    }
+    
+    if (status != fit_read_ok) {
+        errorln("%s: %s!", pos[0], fit_read_message(status));
+        return 1;
+    }
+    
+    fit_poly const& orb = orbit.fit;
+    
+    if (orb.basis == basis_chebyshev and orb.deg > max_cheb_deg) {
+        errorln("Degree of a Chebyshev orbit should be at most %u not %u!",
+                uint(max_cheb_deg), uint(orb.deg));
+        return 1;
+    }
+    
+    if (orb.basis == basis_chebyshev and not (orb.stop_t > orb.start_t)) {
+        errorln("t_stop should be greater than t_start for a Chebyshev "
+                "orbit!");
+        return 1;
+    }
+    
+    zd_params par(size_t(max_iter), zd_solver(solver), zd_seed(seed),
+                  size_t(nthreads), fast_math, geom_output(output));
+    
+    stream_params st(size_t(chunk_rows), float32_in, float32_out,
+                     quiet ? NULL : report);
+    
+    size_t nrows;
+    
+    switch (calc_azi_inc_stream(orb, pos[1], pos[2], par, is_lonlat, st,
+                                nrows)) {
+        case ss_ok:
+            return 0;
+        case ss_open_in:
+            perrorln("inmet_azi_inc", "Failed to read \"%s\"!", pos[1]);
+            return 1;
+        case ss_open_out:
+            perrorln("inmet_azi_inc", "Failed to write \"%s\"!", pos[2]);
+            return 1;
+        case ss_size:
+            errorln("Size of \"%s\" is not a multiple of the size of a "
+                    "(3 column) row!", pos[1]);
+            return 1;
+        case ss_nomem:
+            errorln("Memory allocation failure!");
+            return 1;
+        default:
+            return 1;
+    }
+} // main
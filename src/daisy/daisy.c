@@ -285,6 +285,36 @@ static int cluster(psxys * indata1, int n1, psxys * indata2, int n2,
     return (j);
 } // end cluster  
 
+/* Polynomial sine and cosine used by movements in fast mode, the same as
+ * in src/include/fastmath.hh. Largest absolute error 2.1e-14 (|x| < 1e8). */
+
+static inline void fast_sincos(double x, double * sin_x, double * cos_x)
+{
+    double k, q, r, r2, s, c;
+
+    // x = k pi / 2 + r, pi / 2 in parts of 26 significant bits
+    k = floor(x * 0.6366197723675814 + 0.5);
+    r = ((x - k * 1.5707963109016418) - k * 1.5893254712295857e-08)
+        - k * 6.123233995736766e-17;
+    r2 = r * r;
+
+    s = r + r * r2 * (-1.0 / 6.0 + r2 * (1.0 / 120.0 + r2 * (-1.0 / 5040.0
+          + r2 * (1.0 / 362880.0 + r2 * (-1.0 / 39916800.0
+          + r2 * (1.0 / 6227020800.0))))));
+
+    c = 1.0 - 0.5 * r2 + r2 * r2 * (1.0 / 24.0 + r2 * (-1.0 / 720.0
+          + r2 * (1.0 / 40320.0 + r2 * (-1.0 / 3628800.0
+          + r2 * (1.0 / 479001600.0 + r2 * (-1.0 / 87178291200.0))))));
+
+    // quadrant, k mod 4
+    q = k - 4.0 * floor(k * 0.25);
+
+    if (q == 0.0)      { *sin_x =  s; *cos_x =  c; }
+    else if (q == 1.0) { *sin_x =  c; *cos_x = -s; }
+    else if (q == 2.0) { *sin_x = -s; *cos_x = -c; }
+    else               { *sin_x = -c; *cos_x =  s; }
+} // end fast_sincos
+
 static void axd(double a1, double a2, double a3,
                 double d1, double d2, double d3,
                 double * n1, double * n2, double * n3) {
@@ -294,45 +324,72 @@ static void axd(double a1, double a2, double a3,
     *n3 = a1 * d2 - a2 * d1;
 }
 
-static void movements(station ps, double azi1, double inc1, float v1,
-                      double azi2, double inc2, float v2, float *up,
-                      float *east, FILE * lo)
+/* Body of movements for a constant fast. In fast mode the sine and cosine
+ * of the input angles come from one fast_sincos call each and the angles
+ * derived from atan and asin are never formed: their sine, cosine and
+ * tangent follow from the vector components directly. */
+static inline __attribute__((always_inline))
+void movements_calc(double azi1, double inc1, float v1, double azi2,
+                    double inc2, float v2, float *up, float *east,
+                    const int fast)
 {
     double a1, a2, a3; // unit vector of sat1
     double d1, d2, d3; // unit vector of sat2 
     double n1, n2, n3, ln; // 3D vector and its legths
     double s1, s2, s3, ls; // 3D vector and its legths   
-    double zap, zdp, zad; // angles in observation plain
+    double zap, zdp; // angles in observation plain
     double az, ti, hl;
     double al1, al2, in1, in2;
     double sm, vm; // movements in observation plain
+    double sal1, cal1, sin1, cin1, sal2, cal2, sin2, cin2;
+    double saz, caz, cti, czap, tzap, czdp, tzdp;
 
     al1 = azi1 / 180.0 * M_PI;
     in1 = inc1 / 180.0 * M_PI;
     al2 = azi2 / 180.0 * M_PI;
     in2 = inc2 / 180.0 * M_PI;
+
+    if (fast) {
+        fast_sincos(al1, & sal1, & cal1);
+        fast_sincos(in1, & sin1, & cin1);
+        fast_sincos(al2, & sal2, & cal2);
+        fast_sincos(in2, & sin2, & cin2);
+    } else {
+        sal1 = sin(al1); cal1 = cos(al1);
+        sin1 = sin(in1); cin1 = cos(in1);
+        sal2 = sin(al2); cal2 = cos(al2);
+        sin2 = sin(in2); cin2 = cos(in2);
+    }
     //-------------------------            
-    a1 = -sin(al1) * sin(in1); // E
-    a2 = -cos(al1) * sin(in1); // N
-    a3 = cos(in1); // U         
-    d1 = -sin(al2) * sin(in2);
-    d2 = -cos(al2) * sin(in2);
-    d3 = cos(in2);
+    a1 = -sal1 * sin1; // E
+    a2 = -cal1 * sin1; // N
+    a3 = cin1; // U         
+    d1 = -sal2 * sin2;
+    d2 = -cal2 * sin2;
+    d3 = cin2;
     //-------------------------------------------------------
     axd(a1, a2, a3, d1, d2, d3, & n1, & n2, & n3); // normal vector   
     ln = sqrt(n1 * n1 + n2 * n2 + n3 * n3);
-    zad = asin(ln); // agle between two unit vector
     //-------------------------------------------------------    
     n1 = n1 / ln;
     n2 = n2 / ln;
     n3 = n3 / ln;
-    az = atan(n1 / n2);
-
     hl = sqrt(n1 * n1 + n2 * n2);
-    ti = atan(n3 / hl);
 
-    s1 = -n3 * sin(az);
-    s2 = -n3 * cos(az);
+    if (fast) {
+        // az = atan(n1 / n2), ti = atan(n3 / hl)
+        saz = copysign(1.0, n2) * n1 / hl;
+        caz = fabs(n2) / hl;
+        cti = hl / sqrt(hl * hl + n3 * n3);
+    } else {
+        az = atan(n1 / n2);
+        ti = atan(n3 / hl);
+        saz = sin(az); caz = cos(az);
+        cti = cos(ti);
+    }
+
+    s1 = -n3 * saz;
+    s2 = -n3 * caz;
     s3 = hl;
 
     n1 = s1; //  vector in the plain
@@ -341,17 +398,35 @@ static void movements(station ps, double azi1, double inc1, float v1,
     //---------------------------------------
     axd(a1, a2, a3, n1, n2, n3, & s1, & s2, & s3);
     ls = sqrt(s1 * s1 + s2 * s2 + s3 * s3);
-    zap = asin(ls); // alfa 
+
+    if (fast) {
+        // zap = asin(ls), alfa
+        czap = sqrt((1.0 - ls) * (1.0 + ls));
+        tzap = ls / czap;
+    } else {
+        zap = asin(ls); // alfa 
+        czap = cos(zap);
+        tzap = tan(zap);
+    }
 
     axd(d1, d2, d3, n1, n2, n3, & s1, & s2, & s3);
     ls = sqrt(s1 * s1 + s2 * s2 + s3 * s3);
-    zdp = asin(ls); // beta
 
-    sm = (v2 / cos(zdp) - v1 / cos(zap)) / (tan(zap) + tan(zdp)); // strike movement
-    vm = v1 / cos(zap) + tan(zap) * sm; // tilt movement 
+    if (fast) {
+        // zdp = asin(ls), beta
+        czdp = sqrt((1.0 - ls) * (1.0 + ls));
+        tzdp = ls / czdp;
+    } else {
+        zdp = asin(ls); // beta
+        czdp = cos(zdp);
+        tzdp = tan(zdp);
+    }
+
+    sm = (v2 / czdp - v1 / czap) / (tzap + tzdp); // strike movement
+    vm = v1 / czap + tzap * sm; // tilt movement 
 
-    * up = vm / cos(ti); // biased Up   component
-    * east = sm / cos(az); // biased East component
+    * up = vm / cti; // biased Up   component
+    * east = sm / caz; // biased East component
 
     //  details:    
     //  fprintf(lo,"%16.7e %15.7e %9.3f %7.2lf %6.2lf %6.2f %7.2lf %6.2f %6.2f %7.2lf %7.2lf %6.2lf %6.2lf %6.2lf\n",
@@ -362,6 +437,17 @@ static void movements(station ps, double azi1, double inc1, float v1,
     //             ti/M_PI*180.0,
     //             sm,vm);  
 
+} // end movements_calc
+
+static void movements(station ps, double azi1, double inc1, float v1,
+                      double azi2, double inc2, float v2, float *up,
+                      float *east, FILE * lo, int fast)
+{
+    // branch once, each call is compiled with a constant fast
+    if (fast)
+        movements_calc(azi1, inc1, v1, azi2, inc2, v2, up, east, 1);
+    else
+        movements_calc(azi1, inc1, v1, azi2, inc2, v2, up, east, 0);
 } // end  movement
 //++++++++++++++++++++++++++++++++++++++++++
 
@@ -1023,6 +1109,9 @@ int integrate(int argc, char * argv[]) {
 
     FILE *ind, * ino1, *ino2, *ou, *lo;
 
+    // optional 4th argument: polynomial instead of libm trigonometry
+    int fast = argc - Minarg > 3 && Str_IsEqual(argv[5], "fast");
+
     if ((buf = (char * ) malloc(80 * sizeof(char))) == NULL) {
         error("\nNot enough memory to allocate BUF\n");
         exit(1);
@@ -1042,10 +1131,12 @@ int integrate(int argc, char * argv[]) {
     if (argc - Minarg < 3) {
         printf(
         "\n usage:                                                      \n\
-         \n    daisy integrate dominant.xyd asc_master.porb dsc_master.porb\n\
+         \n    daisy integrate dominant.xyd asc_master.porb dsc_master.porb [fast]\n\
          \n              dominant.xyd  - (1st) dominant DSs data file   \
          \n           asc_master.porb  - (2nd) ASC polynomial orbit file\
-         \n           dsc_master.porb  - (3rd) DSC polynomial orbit file\n\
+         \n           dsc_master.porb  - (3rd) DSC polynomial orbit file\
+         \n                      fast  - (4th) polynomial sin, cos and no \
+         \n                              atan, asin (optional)\n\
          \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
         exit(1);
     }
@@ -1118,7 +1209,7 @@ int integrate(int argc, char * argv[]) {
         closest_appr(pol2, dop2, ft2, lt2, &ps, &sat);
         azim_elev(ps, sat, & azi2, & inc2);
 
-        movements(ps, azi1, inc1, v1, azi2, inc2, v2, & up, & east, lo);
+        movements(ps, azi1, inc1, v1, azi2, inc2, v2, & up, & east, lo, fast);
 
         fprintf(ou, "%16.7e %15.7e %9.3f %7.3f %7.3f\n", la, fi, he, east, up);
         n++;
@@ -5,6 +5,14 @@
 
 #include "common_macros.hh"
 
+// mem_align aligned memory, NULL on failure; blocks of array_alloc are
+// only freed with array_free
+void *array_alloc(size_t const num_bytes);
+void array_free(void *ptr);
+
+
+/* Scratch buffer of the kernels, its storage is mem_align aligned. init
+ * leaves the elements uninitialized, zeros sets them to zero. */
 template <class T>
 struct array {
     T* data;
@@ -13,56 +21,56 @@ struct array {
     array(): data(NULL), size(0) {};
     
     ~array() {
-        Mem_Del(data);
+        array_free(data);
+        data = NULL;
         size = 0;
     }
-
-
+    
+    
     #ifndef __INMET_IMPL
-    bool const init(size_t const init_size);
-    bool const init(size_t const init_size, T const init_value);
-    bool const init(array<T> const& original);
+    bool init(size_t const init_size);
+    bool init(size_t const init_size, T const init_value);
+    bool init(array<T> const& original);
+    bool zeros(size_t const init_size);
     array& operator= (array const & copy);
     #else
-
+    
+    // deep copy; on allocation failure the array is left as it was
     array<T>& operator= (array<T> const& copy) {
-        // Return quickly on assignment to self.
-        if (this == &copy) {
+        if (this == &copy)
             return *this;
-        }
-    
-        // Do all operations that can generate an expception first.
-        // BUT DO NOT MODIFY THE OBJECT at this stage.
-        T* tmp = Mem_New(T, size);
-    
-        for(size_t ii = 0; ii < size; ++ii)
+        
+        T* tmp = (T*) array_alloc(copy.size * sizeof(T));
+        
+        if (tmp == NULL and copy.size > 0)
+            return *this;
+        
+        for(size_t ii = copy.size; ii--; )
             tmp[ii] = copy.data[ii];
-    
-        // Now that you have finished all the dangerous work.
-        // Do the operations that  change the object.
-        //std::swap(tmp, data);
+        
+        array_free(data);
+        data = tmp;
         size = copy.size;
-    
-        // Finally tidy up
-        Mem_Del(tmp);
-    
-        // Now you can return
+        
         return *this;
     }
-
-    bool const init(size_t const init_size) {
-        if ((data = Mem_New(T, init_size)) == NULL)
+    
+    bool init(size_t const init_size) {
+        array_free(data);
+        data = NULL;
+        size = 0;
+        
+        if (init_size > size_t(-1) / 2 / sizeof(T)
+            or (data = (T*) array_alloc(init_size * sizeof(T))) == NULL)
             return true;
         
         size = init_size;
         return false;
     }
     
-    bool const init(size_t const init_size, T const init_value) {
-        if ((data = Mem_New(T, init_size)) == NULL)
+    bool init(size_t const init_size, T const init_value) {
+        if (init(init_size))
             return true;
-    
-        size = init_size;
         
         for(size_t ii = size; ii--; )
             data[ii] = init_value;
@@ -70,10 +78,8 @@ struct array {
         return false;
     }
     
-    bool const init(array<T> const & original) {
-        size = original.size;
-    
-        if ((data = Mem_New(T, size)) == NULL)
+    bool init(array<T> const & original) {
+        if (init(original.size))
             return true;
         
         for(size_t ii = size; ii--; )
@@ -82,6 +88,10 @@ struct array {
         return false;
     }
     
+    bool zeros(size_t const init_size) {
+        return init(init_size, T(0));
+    }
+    
     #endif
     
     T& operator[](size_t const index) {
@@ -92,7 +102,10 @@ struct array {
     T const operator[](size_t const index) const {
         return data[index];
     }
-    
+
+private:
+    // copies are made with init or operator=, which can fail
+    array(array const&);
 };
 
 #endif
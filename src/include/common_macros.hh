@@ -1,7 +1,7 @@
 #ifndef CAPI_MACROS_HPP
 #define CAPI_MACROS_HPP
 
-#include "Python.h"
+#include <stdlib.h>
 
 // some functions are inline, in case your compiler doesn't like "static inline"
 // but wants "__inline__" or something instead, #define DG_DYNARR_INLINE accordingly.
@@ -23,12 +23,27 @@
 #endif
 
 
+// Allocator of the core library, plain C memory without the Python
+// runtime, so array and Pool can also be used with the GIL released.
 #ifndef DG_DYNARR_MALLOC
-	#define Mem_New(elem_type, n_elem) PyMem_New(elem_type, n_elem)
+	#define Mem_Malloc malloc
+	#define Mem_Realloc realloc
+	#define Mem_Free free
 
-	#define Mem_Resize(ptr, elem_type, new_n_elem) PyMem_Resize(ptr, elem_type, new_n_elem)
+	#define Mem_New(elem_type, n_elem) \
+		((size_t)(n_elem) > ((size_t) -1) / 2 / sizeof(elem_type) ? NULL : \
+		 (elem_type *) Mem_Malloc((n_elem) * sizeof(elem_type)))
 
-	#define Mem_Del(ptr) PyMem_Del(ptr)
+	#define Mem_Resize(ptr, elem_type, new_n_elem) \
+		((ptr) = (size_t)(new_n_elem) > ((size_t) -1) / 2 / sizeof(elem_type) ? \
+		 NULL : (elem_type *) Mem_Realloc((ptr), \
+		                                  (new_n_elem) * sizeof(elem_type)))
+
+	#define Mem_Del(ptr) Mem_Free(ptr)
 #endif
 
+// alignment of the storage of array and of the buffers of Pool, a cache
+// line (SIMD loads of any width)
+static const size_t mem_align = 64;
+
 #endif
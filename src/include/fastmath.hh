@@ -0,0 +1,169 @@
+/* Copyright (C) 2018  István Bozsó
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FASTMATH_HH
+#define FASTMATH_HH
+
+#include "utils.hh"
+#include "simd.hh"
+
+/* Polynomial approximations of elementary functions on SIMD lanes, used by
+ * the kernels when they are called with fast_math. They are built from the
+ * operations of simd.hh only, so a lane gives the same result with every
+ * instruction set. libm remains the reference.
+ *
+ * Largest absolute errors, polynomial truncation and rounding included:
+ *
+ *     vsincos     2.1e-14    |x| < 1e8
+ *     vatan       1.2e-12
+ *     vacos       2.4e-12
+ *     vatanh      5e-12      |x| < 1 - 1e-9
+ *
+ * measured against libm on 3e6 random arguments. The error of vatanh near
+ * +-1 comes from the conditioning of atanh itself. */
+
+// round to nearest integer, |x| < 2^51
+static inline vdouble vround(vdouble const x)
+{
+#if SIMD_WIDTH == 1
+    // the trick below fails with the excess precision of the x87 unit
+    return floor(x.v + 0.5);
+#else
+    vdouble const magic = 6755399441055744.0;   // 1.5 * 2^52
+    return (x + magic) - magic;
+#endif
+}
+
+
+// mask with every lane set
+static inline vmask vtrue()
+{
+    return vgt(vdouble(1.0), vdouble(0.0));
+}
+
+
+static inline void vsincos(vdouble const x, vdouble& sin_x, vdouble& cos_x)
+{
+    // pi / 2 split into parts of 26 significant bits (Cody-Waite)
+    vdouble const pio2_1 = 1.5707963109016418, pio2_2 = 1.5893254712295857e-08,
+                  pio2_3 = 6.123233995736766e-17, one = 1.0, half = 0.5,
+                  three_half = 1.5;
+    vdouble k, q, r, r2, s, c;
+    vmask swap, neg_s, neg_c;
+
+    // x = k pi / 2 + r, |r| <= pi / 4, k * pio2_1 and k * pio2_2 are exact
+    k = vround(x * vdouble(0.6366197723675814));
+    r = ((x - k * pio2_1) - k * pio2_2) - k * pio2_3;
+    r2 = r * r;
+
+    // Taylor series up to r^13 and r^14
+    s = r + r * r2 * (vdouble(-1.0 / 6.0)
+             + r2 * (vdouble(1.0 / 120.0)
+             + r2 * (vdouble(-1.0 / 5040.0)
+             + r2 * (vdouble(1.0 / 362880.0)
+             + r2 * (vdouble(-1.0 / 39916800.0)
+             + r2 * vdouble(1.0 / 6227020800.0))))));
+
+    c = one - half * r2 + r2 * r2 * (vdouble(1.0 / 24.0)
+                             + r2 * (vdouble(-1.0 / 720.0)
+                             + r2 * (vdouble(1.0 / 40320.0)
+                             + r2 * (vdouble(-1.0 / 3628800.0)
+                             + r2 * (vdouble(1.0 / 479001600.0)
+                             + r2 * vdouble(-1.0 / 87178291200.0))))));
+
+    // quadrant, k mod 4 in [-2, 2]
+    q = k - vdouble(4.0) * vround(k * vdouble(0.25));
+
+    swap = vgt(vabs(q), half) & vgt(three_half, vabs(q));
+    neg_s = vandnot(vgt(q, -half) & vgt(three_half, q), vtrue());
+    neg_c = vandnot(vgt(q, -three_half) & vgt(half, q), vtrue());
+
+    sin_x = vselect(swap, c, s);
+    cos_x = vselect(swap, s, c);
+
+    sin_x = vselect(neg_s, -sin_x, sin_x);
+    cos_x = vselect(neg_c, -cos_x, cos_x);
+} // vsincos
+
+
+static inline vdouble vatan(vdouble const x)
+{
+    vdouble const zero = 0.0, one = 1.0;
+    vdouble a = vabs(x), t, u, p;
+
+    // tan(3 pi / 8), tan(pi / 8)
+    vmask big = vgt(a, vdouble(2.414213562373095)),
+          mid = vandnot(big, vgt(a, vdouble(0.41421356237309503)));
+
+    // |t| <= tan(pi / 8)
+    t = vselect(big, -one / a, vselect(mid, (a - one) / (a + one), a));
+    u = t * t;
+
+    p = t + t * u * (vdouble(-0.33333333330948595)
+             + u * (vdouble(0.19999998853284645)
+             + u * (vdouble(-0.14285610087150133)
+             + u * (vdouble(0.11107455285302732)
+             + u * (vdouble(-0.09028662534052881)
+             + u * (vdouble(0.07134078995666564)
+             + u * vdouble(-0.04041362148086242)))))));
+
+    p = vselect(big, vdouble(1.5707963267948966) + p,
+                vselect(mid, vdouble(0.7853981633974483) + p, p));
+
+    return vselect(vgt(zero, x), -p, p);
+} // vatan
+
+
+// acos(x) = 2 atan(sqrt((1 - x) / (1 + x))), -1 <= x <= 1
+static inline vdouble vacos(vdouble const x)
+{
+    vdouble const one = 1.0;
+    return vdouble(2.0) * vatan(vsqrt((one - x) / (one + x)));
+}
+
+
+// |x| < 1
+static inline vdouble vatanh(vdouble x)
+{
+    vdouble const one = 1.0;
+    vdouble u;
+
+    // atanh(x) = 2 atanh(x / (1 + sqrt(1 - x^2))), applied six times
+    FOR(ii, 6)
+        x = x / (one + vsqrt((one - x) * (one + x)));
+
+    // Taylor series up to x^15, |x| < 0.17
+    u = x * x;
+
+    return vdouble(64.0) * (x + x * u * (vdouble(1.0 / 3.0)
+                                + u * (vdouble(1.0 / 5.0)
+                                + u * (vdouble(1.0 / 7.0)
+                                + u * (vdouble(1.0 / 9.0)
+                                + u * (vdouble(1.0 / 11.0)
+                                + u * (vdouble(1.0 / 13.0)
+                                + u * vdouble(1.0 / 15.0))))))));
+} // vatanh
+
+
+// first lane, to use the functions above on a single value
+static inline double lane0(vdouble const a)
+{
+    double tmp[SIMD_WIDTH];
+    vstore(tmp, a);
+    return tmp[0];
+}
+
+#endif // FASTMATH_HH
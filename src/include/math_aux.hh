@@ -22,17 +22,32 @@
 #include "view.hh"
 
 
+// basis functions of a fitted polynom
+enum poly_basis {
+    // powers of t (t - mean_t if centered), highest power first
+    basis_power = 0,
+    // Chebyshev polynoms of t scaled from [start_t, stop_t] to [-1, 1],
+    // lowest order first (numpy.polynomial.chebyshev order)
+    basis_chebyshev = 1
+};
+
 // structure for storing fitted polynom coefficients
 struct fit_poly {
     double mean_t, start_t, stop_t, *mean_coords;
     view<double> &coeffs;
     size_t is_centered, deg;
+    poly_basis basis;
+    
+    // basis_power: coefficients of the time derivative (3, deg + 1),
+    // highest power first, computed from coeffs if NULL
+    view<double> const *vel_coeffs;
     
     fit_poly(double mean_t, double start_t, double stop_t, double *mean_coords,
-             view<double> &coeffs, size_t is_centered, size_t deg):
+             view<double> &coeffs, size_t is_centered, size_t deg,
+             poly_basis basis = basis_power):
              mean_t(mean_t), start_t(start_t), stop_t(stop_t),
              mean_coords(mean_coords), coeffs(coeffs), is_centered(is_centered),
-             deg(deg) {};
+             deg(deg), basis(basis), vel_coeffs(NULL) {};
     
     ~fit_poly() {};
 };
@@ -4,6 +4,18 @@
 #include <stddef.h>
 
 #include "Python.h"
+
+#include "array.hh"
+#include "vector.hh"
+
+// numpy C API table is shared between translation units, it is filled in
+// by import_array() in the module initialization function
+#define PY_ARRAY_UNIQUE_SYMBOL inmet_aux_ARRAY_API
+
+#ifndef INMET_AUX_MODULE
+#define NO_IMPORT_ARRAY
+#endif
+
 #include "numpy/arrayobject.h"
 
 #define array_type(ar_struct) &((ar_struct).pyobj)
@@ -11,6 +23,8 @@
 
 enum dtype {
     dt_double = NPY_DOUBLE,
+    dt_float = NPY_FLOAT,
+    dt_int = NPY_INT,
     dt_bool = NPY_BOOL
 };
 
@@ -33,7 +47,8 @@ struct nparray {
             {};
     
     ~nparray() {
-        PyMem_Del(strides);
+        // allocated with new[] by setup_array, no GIL needed
+        delete[] strides;
         strides = shape = NULL;
         
         if (decref)
@@ -41,7 +56,47 @@ struct nparray {
     }
     
     bool import(int const typenum, size_t const ndim = 0, PyObject* obj = NULL);
+    bool import_out(int const typenum, size_t const ndim = 0,
+                    PyObject* obj = NULL);
     bool from_data(int const typenum, void *data, size_t num, ...);
+    
+    /* New array of storage from array_alloc (vector::release), the numpy
+     * array frees it with array_free. data is taken over even on
+     * failure, strides are in elements. */
+    bool adopt_strided(int const typenum, void *data, size_t const ndim,
+                       size_t const* shape, size_t const* strides);
+    
+    // (size / ncols, ncols) array, 1D if ncols is 1; vec is left empty
+    template<class T>
+    bool adopt(int const typenum, vector<T>& vec, size_t const ncols = 1) {
+        // numpy needs storage even for no elements
+        if (vec.reserve(1)) {
+            PyErr_NoMemory();
+            return true;
+        }
+        
+        size_t const shape[2] = {vec.size / ncols, ncols},
+                     strides[2] = {ncols, 1};
+        
+        if (ncols == 1)
+            return adopt_strided(typenum, vec.release(), 1, shape, strides + 1);
+        
+        return adopt_strided(typenum, vec.release(), 2, shape, strides);
+    }
+    
+    // (size, ncols) array of the columns of vec; vec is left empty
+    template<class T>
+    bool adopt(int const typenum, soa_vector<T>& vec) {
+        if (vec.reserve(1)) {
+            PyErr_NoMemory();
+            return true;
+        }
+        
+        size_t const shape[2] = {vec.size, vec.ncols},
+                     strides[2] = {1, vec.cap};
+        
+        return adopt_strided(typenum, vec.release(), 2, shape, strides);
+    }
     bool empty(int const typenum, int const fortran, size_t num, ...);
     bool zeros(int const typenum, int const fortran, size_t num, ...);
     
@@ -51,6 +106,10 @@ struct nparray {
     bool check_rows(size_t const rows) const;
     bool check_cols(size_t const cols) const;
     bool is_f_cont() const;
+    
+    bool is_float() const {
+        return typenum == dt_float;
+    }
 };
 
 #if 0
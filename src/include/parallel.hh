@@ -0,0 +1,38 @@
+/* Copyright (C) 2018  István Bozsó
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARALLEL_HH
+#define PARALLEL_HH
+
+#include <stddef.h>
+
+// upper limit of worker threads
+static const size_t max_threads = 256;
+
+// processes work items [begin, end)
+typedef void (*work_fun)(void *ctx, size_t const begin, size_t const end);
+
+// number of online processors
+size_t num_cpus();
+
+/* Splits [0, num) into nthreads contiguous ranges and calls fun on each
+ * range from its own thread (the calling thread takes the first range).
+ * nthreads == 0 means num_cpus(). If a thread cannot be started its range
+ * is processed by the calling thread. Does not allocate memory and does not
+ * touch the Python runtime, so it can be called with the GIL released. */
+void parallel_for(size_t const num, size_t nthreads, work_fun fun, void *ctx);
+
+#endif // PARALLEL_HH
@@ -76,6 +76,12 @@ do {\
 // Python 2/3
 #endif 
 
+// before Python 3.9
+#ifndef Py_SET_REFCNT
+#define Py_SET_REFCNT(ob, refcnt) (Py_REFCNT(ob) = (refcnt))
+#define Py_SET_TYPE(ob, type) (Py_TYPE(ob) = (type))
+#endif
+
 
 
 #if 0
@@ -26,20 +26,308 @@
  ***********/
 
 
+// highest degree of orbits with basis_chebyshev
+static const size_t max_cheb_deg = 31;
+
 // cartesian coordinate
 struct cart {
     double x, y, z;
     cart() {};
 };
 
+// zero-Doppler time solvers of closest_appr
+enum zd_solver {
+    zd_bisect = 0,
+    zd_newton = 1,
+    zd_halley = 2
+};
+
+// starting point of the zero-Doppler time search
+enum zd_seed {
+    zd_cold = 0,        // whole orbit window for every point
+    zd_warm = 1,        // seed from the previous point, input is pre-sorted
+    zd_warm_sort = 2    // sort points along-track first, then as zd_warm
+};
+
+// quantities computed per point by calc_azi_inc
+enum geom_output {
+    go_angles = 0,      // azimuth, incidence angle [deg]
+    go_los = 1,         // east, north, up unit vector pointing to the satellite
+    go_los_range = 2,   // the same and the slant range [m]
+    go_angles_range = 3,// azimuth, incidence angle [deg], slant range [m]
+    go_radar = 4        // zero-Doppler time [s], slant range [m],
+                        // satellite position [m] and velocity [m/s]
+};
+
+// largest number of output columns of calc_azi_inc
+static const size_t max_geom_ncols = 8;
+
+// number of output columns of calc_azi_inc
+static inline size_t geom_ncols(geom_output const output)
+{
+    switch (output) {
+        case go_angles:
+            return 2;
+        case go_los_range:
+            return 4;
+        case go_radar:
+            return 8;
+        default:
+            return 3;
+    }
+}
+
+// parameters of the zero-Doppler time search
+struct zd_params {
+    size_t max_iter;
+    zd_solver solver;
+    zd_seed seed;
+    size_t nthreads;    // 0 means one thread per processor
+    bool fast_math;     // polynomial sin, cos, acos, atan instead of libm
+    geom_output output;
+    
+    zd_params(size_t max_iter, zd_solver solver = zd_bisect,
+              zd_seed seed = zd_cold, size_t nthreads = 1,
+              bool fast_math = false, geom_output output = go_angles):
+              max_iter(max_iter), solver(solver), seed(seed),
+              nthreads(nthreads), fast_math(fast_math), output(output) {};
+};
+
 void ell_cart (cdouble lon, cdouble lat, cdouble h,
                double& x, double& y, double& z);
 
 void cart_ell(cdouble x, cdouble y, cdouble z,
               double& lon, double& lat, double& h);
 
-void calc_azi_inc(const fit_poly& orb, view<double> const& coords,
-                  view<double>& azi_inc, size_t const max_iter,
-                  bool const is_lonlat);
+/* Algorithms of calc_cart_ell. Largest errors of latitude and height for
+ * -500 m < h < 9 km: 2.3e-12 rad, 1.4e-5 m (ce_bowring), 2.3e-12 rad,
+ * 5e-9 m (ce_fast), 5e-16 rad, 5e-9 m (ce_exact). Up to h = 1000 km Bowring's
+ * latitude error grows to 9e-10 rad. */
+enum cart_ell_method {
+    ce_bowring = 0,     // cart_ell: Bowring's formula, one iteration
+    ce_fast = 1,        // the same without sin / cos, SIMD lanes
+    ce_exact = 2        // closed form solution of Vermeille (2002)
+};
+
+/* Conversion of the rows of (n, 3) arrays between geodetic (lon, lat, h)
+ * and WGS-84 Cartesian (X, Y, Z) coordinates on nthreads threads. lon, lat
+ * are in degrees if is_deg is true, radians otherwise, lon is in
+ * (-180, 180]. The output may be the input array itself. With fast_math
+ * sin and cos come from fastmath.hh, the error stays below 2e-7 m. */
+void calc_ell_cart(view<double> const& ell, view<double>& xyz,
+                   bool const is_deg, size_t const nthreads = 1,
+                   bool const fast_math = false);
+
+void calc_cart_ell(view<double> const& xyz, view<double>& ell,
+                   cart_ell_method const method, bool const is_deg,
+                   size_t const nthreads = 1);
+
+/* Mercator projection of lon, lat onto xy (n, 2), e is the eccentricity of
+ * the ellipsoid (0 for a sphere), a its semi-major axis. */
+void calc_ell_merc(real_view const& lon, real_view const& lat,
+                   real_view& xy, double const lon0, double const a,
+                   double const e, bool const is_deg, bool const fast_math);
+
+// spacing of the lon/lat/height lookup table of calc_azi_inc_lut
+struct lut_params {
+    double dlon, dlat, dh;  // [deg], [deg], [m]
+    
+    lut_params(double dlon, double dlat, double dh):
+               dlon(dlon), dlat(dlat), dh(dh) {};
+};
+
+/* calc_azi_inc processes points in segments of azi_inc_segment rows. Warm
+ * start seeds do not cross segment boundaries and threads always receive
+ * whole segments, so the results do not depend on the number of threads
+ * or, except with zd_warm_sort, on splitting the points at multiples of
+ * azi_inc_segment. */
+static const size_t azi_inc_segment = 4096;
+
+// azi_inc has geom_ncols(par.output) columns, niter, if not NULL, receives
+// the number of iterations spent per point, returns true on (memory
+// allocation) failure
+bool calc_azi_inc(const fit_poly& orb, real_view const& coords,
+                  real_view& azi_inc, zd_params const& par,
+                  bool const is_lonlat, view<int>* niter = NULL);
+
+// orbits of the same degree and basis, stacked along the first axis
+struct orbit_stack {
+    view<double> const &mean_t, &start_t, &stop_t;  // (norb)
+    view<double> const &mean_coords;                // (norb, 3)
+    view<double> const &coeffs;                     // (norb, 3, deg + 1)
+    size_t norb, is_centered, deg;
+    poly_basis basis;
+    
+    orbit_stack(view<double> const& mean_t, view<double> const& start_t,
+                view<double> const& stop_t, view<double> const& mean_coords,
+                view<double> const& coeffs, size_t is_centered, size_t deg,
+                poly_basis basis = basis_power):
+                mean_t(mean_t), start_t(start_t), stop_t(stop_t),
+                mean_coords(mean_coords), coeffs(coeffs),
+                norb(coeffs.shape[0]), is_centered(is_centered), deg(deg),
+                basis(basis) {};
+};
+
+/* calc_azi_inc for every orbit of orbs, azi_inc is (npoint, norb,
+ * geom_ncols(par.output)). The points are converted only once and each
+ * block of points is run against all orbits before moving on. Results
+ * are the same as those of calc_azi_inc with cold seeds. Returns true on
+ * (memory allocation) failure. */
+bool calc_azi_inc_multi(orbit_stack const& orbs, view<double> const& coords,
+                        view<double>& azi_inc, zd_params const& par,
+                        bool const is_lonlat);
+
+/* Geometry of a time series, orbs holds one orbit per date. The points
+ * are solved for the master date first, then their zero-Doppler times,
+ * shifted by the difference of the orbit window centers, seed the search
+ * of all other dates (par.seed is used for the master date only). Work is
+ * spread over threads by point tiles and dates. azi_inc is (npoint, norb,
+ * geom_ncols(par.output)). Returns true on (memory allocation) failure. */
+bool calc_azi_inc_dates(orbit_stack const& orbs, size_t const master,
+                        view<double> const& coords, view<double>& azi_inc,
+                        zd_params const& par, bool const is_lonlat);
+
+// sampling of a SAR image
+struct sar_params {
+    double t_first,     // zero-Doppler time of the first line [s]
+           prf,         // pulse repetition frequency [Hz]
+           near_range,  // slant range of the first pixel [m]
+           rsr;         // range sampling rate [Hz]
+    
+    sar_params(double t_first, double prf, double near_range, double rsr):
+               t_first(t_first), prf(prf), near_range(near_range),
+               rsr(rsr) {};
+};
+
+/* Line and pixel coordinates (n, 2) of points from the first two columns
+ * of the go_radar output of calc_azi_inc. */
+void calc_line_pixel(real_view const& radar, real_view& line_pixel,
+                     sar_params const& sar);
+
+// heights on a regular lon/lat grid, bilinearly interpolated
+struct dem_grid {
+    view<double> const *height; // (nlat, nlon) [m], at least 2 x 2, NULL:
+                                // constant h0 everywhere
+    double lon_first, lat_first,// center of the first cell [deg]
+           dlon, dlat,          // spacing [deg], may be negative
+           h0;                  // [m]
+    
+    dem_grid(view<double> const *height, double lon_first, double lat_first,
+             double dlon, double dlat, double h0 = 0.0):
+             height(height), lon_first(lon_first), lat_first(lat_first),
+             dlon(dlon), dlat(dlat), h0(h0) {};
+};
+
+// pixels of a geocoded raster, row ii, column jj is at line
+// first_line + ii * line_step and pixel first_pixel + jj * pixel_step
+struct raster_params {
+    double first_line, first_pixel, line_step, pixel_step;
+    
+    raster_params(double first_line = 0.0, double first_pixel = 0.0,
+                  double line_step = 1.0, double pixel_step = 1.0):
+                  first_line(first_line), first_pixel(first_pixel),
+                  line_step(line_step), pixel_step(pixel_step) {};
+};
+
+struct geocode_params {
+    size_t max_iter;    // height updates per pixel
+    double tol;         // accepted height misfit [m]
+    bool look_right;
+    size_t nthreads;    // 0 means one thread per processor
+    
+    geocode_params(size_t max_iter = 20, double tol = 1e-3,
+                   bool look_right = true, size_t nthreads = 1):
+                   max_iter(max_iter), tol(tol), look_right(look_right),
+                   nthreads(nthreads) {};
+};
+
+/* Forward geocoding: the point of the DEM surface seen at zero-Doppler
+ * time t and slant range r. The range sphere, the zero-Doppler plane and
+ * an ellipsoid inflated by the height are intersected (Newton), the
+ * height of the ellipsoid is then corrected by the misfit to the DEM
+ * until it drops below par.tol.
+ *
+ * If radar is not NULL its rows (n, 2) hold (line, pixel) with
+ * is_line_pixel, (t [s], r [m]) otherwise, and ell is (n, 1, 3). Without
+ * radar ell is (nrow, ncol, 3) and covers the raster of raster, the rows
+ * are lines, the solution of a pixel is the starting point of the next one.
+ * ell receives lon, lat [deg], h [m]; NaN marks pixels outside of the DEM
+ * or without convergence. Rows are spread over par.nthreads threads. */
+void calc_geocode(const fit_poly& orb, view<double> const* radar,
+                  bool const is_line_pixel, raster_params const& raster,
+                  sar_params const& sar, dem_grid const& dem,
+                  view<double>& ell, geocode_params const& par);
+
+// largest number of lattice nodes calc_azi_inc_lut sets up
+static const size_t lut_max_node = size_t(1) << 24;
+
+// outcome of calc_azi_inc_lut
+enum lut_status {
+    lut_ok = 0,
+    lut_no_memory = 1,
+    lut_too_large = 2   // the lattice would have more than lut_max_node nodes
+};
+
+/* Solves the geometry exactly on a lattice covering the bounding box of
+ * the finite points of coords only, then interpolates azimuth and incidence
+ * trilinearly, points with non-finite coordinates receive NaN. lut_err
+ * receives the largest interpolation error of azimuth and incidence [deg]
+ * found at the centers of the lattice cells, par.output should be
+ * go_angles. The steps of lut should be positive and finite. */
+lut_status calc_azi_inc_lut(const fit_poly& orb, real_view const& coords,
+                            real_view& azi_inc, zd_params const& par,
+                            bool const is_lonlat, lut_params const& lut,
+                            double lut_err[2]);
+
+// outcome of sat_orbit::read
+enum fit_read_status {
+    fit_read_ok = 0,
+    fit_read_io = 1,        // the file could not be opened or read, see errno
+    fit_read_missing = 2,   // deg, t_start or t_stop is missing
+    fit_read_mean = 3,      // mean_coords does not hold 3 numbers
+    fit_read_coeffs = 4,    // coefficients do not hold 3 * (deg + 1) numbers
+    fit_read_no_memory = 5
+};
+
+// description of a failed sat_orbit::read
+char const* fit_read_message(fit_read_status const status);
+
+/* Orbit polynom that owns its (64 byte aligned) coefficients, set up once
+ * and then evaluated any number of times through fit. For basis_power the
+ * coefficients of the velocity are computed at setup, not per call. */
+struct sat_orbit {
+    Pool pool;
+    double mean_coords[3];
+    size_t shape[2], strides[2];
+    view<double> coeffs, vel_coeffs;    // (3, deg + 1)
+    fit_poly fit;
+    
+    sat_orbit();
+    
+    // copies the parameters, returns true on (memory allocation) failure
+    bool init(double const mean_t, double const start_t, double const stop_t,
+              double const mean_coords[3], view<double> const& coeffs,
+              bool const is_centered, size_t const deg,
+              poly_basis const basis = basis_power);
+    
+    // fit file saved by Satorbit.save_fit, prints nothing on failure
+    fit_read_status read(char const* path);
+    
+    /* Least squares fit of pos (n, 3) at time (n) as Satorbit.fit_orbit
+     * does it, n should be greater than deg. Returns true on (memory
+     * allocation) failure. */
+    bool fit_state(view<double> const& time, view<double> const& pos,
+                   size_t const deg, bool const is_centered,
+                   poly_basis const basis = basis_power);
+    
+private:
+    sat_orbit(sat_orbit const&);
+    sat_orbit& operator=(sat_orbit const&);
+};
+
+// satellite positions pos (n, 3) [m] and velocities vel (n, 3) [m/s] at
+// time (n), either may be NULL
+void calc_orbit_state(const fit_poly& orb, view<double> const& time,
+                      view<double>* pos, view<double>* vel);
 
 #endif // SATORBIT_H
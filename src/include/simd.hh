@@ -0,0 +1,223 @@
+/* Copyright (C) 2018  István Bozsó
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIMD_HH
+#define SIMD_HH
+
+/* Thin wrapper around the widest double precision vector unit the compiler
+ * was told about (-mavx512f, -mavx / -mavx2, SSE2 on x86-64). Without any
+ * of them a single lane "vector" is used so kernels written with vdouble
+ * still compile and produce the same results.
+ *
+ * Only operations that are correctly rounded (+, -, *, /, sqrt) are
+ * provided, no fused multiply-add, so that a lane computes bit for bit
+ * the same value as the equivalent scalar expression. */
+
+#if defined(__AVX512F__)
+
+#include <immintrin.h>
+
+#define SIMD_WIDTH 8
+#define SIMD_NAME "avx512"
+
+struct vdouble {
+    __m512d v;
+    vdouble() {};
+    vdouble(__m512d const v): v(v) {};
+    vdouble(double const d): v(_mm512_set1_pd(d)) {};
+};
+
+struct vmask {
+    __mmask8 m;
+    vmask() {};
+    vmask(__mmask8 const m): m(m) {};
+};
+
+static inline vdouble vload(double const* ptr) { return _mm512_loadu_pd(ptr); }
+static inline void vstore(double* ptr, vdouble const a) { _mm512_storeu_pd(ptr, a.v); }
+
+static inline vdouble operator-(vdouble const a)
+{
+    return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a.v),
+                               _mm512_set1_epi64(0x8000000000000000LL)));
+}
+
+static inline vdouble operator+(vdouble const a, vdouble const b) { return _mm512_add_pd(a.v, b.v); }
+static inline vdouble operator-(vdouble const a, vdouble const b) { return _mm512_sub_pd(a.v, b.v); }
+static inline vdouble operator*(vdouble const a, vdouble const b) { return _mm512_mul_pd(a.v, b.v); }
+static inline vdouble operator/(vdouble const a, vdouble const b) { return _mm512_div_pd(a.v, b.v); }
+
+// the unmasked forms start from _mm512_undefined_pd, which GCC 12 flags
+// with -Wmaybe-uninitialized; all lanes are set either way
+static inline vdouble vsqrt(vdouble const a) { return _mm512_mask_sqrt_pd(a.v, 0xff, a.v); }
+static inline vdouble vmin(vdouble const a, vdouble const b) { return _mm512_mask_min_pd(a.v, 0xff, a.v, b.v); }
+static inline vdouble vmax(vdouble const a, vdouble const b) { return _mm512_mask_max_pd(a.v, 0xff, a.v, b.v); }
+
+static inline vdouble vabs(vdouble const a)
+{
+    return _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(a.v),
+                               _mm512_set1_epi64(0x7fffffffffffffffLL)));
+}
+
+static inline vmask vgt(vdouble const a, vdouble const b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ); }
+
+static inline vmask operator&(vmask const a, vmask const b) { return __mmask8(a.m & b.m); }
+static inline vmask vandnot(vmask const a, vmask const b) { return __mmask8(~a.m & b.m); }
+static inline bool vany(vmask const a) { return a.m != 0; }
+
+// select a where mask is set, b elsewhere
+static inline vdouble vselect(vmask const m, vdouble const a, vdouble const b)
+{
+    return _mm512_mask_blend_pd(m.m, b.v, a.v);
+}
+
+#elif defined(__AVX__)
+
+#include <immintrin.h>
+
+#define SIMD_WIDTH 4
+#define SIMD_NAME "avx"
+
+struct vdouble {
+    __m256d v;
+    vdouble() {};
+    vdouble(__m256d const v): v(v) {};
+    vdouble(double const d): v(_mm256_set1_pd(d)) {};
+};
+
+struct vmask {
+    __m256d m;
+    vmask() {};
+    vmask(__m256d const m): m(m) {};
+};
+
+static inline vdouble vload(double const* ptr) { return _mm256_loadu_pd(ptr); }
+static inline void vstore(double* ptr, vdouble const a) { _mm256_storeu_pd(ptr, a.v); }
+
+static inline vdouble operator-(vdouble const a) { return _mm256_xor_pd(_mm256_set1_pd(-0.0), a.v); }
+static inline vdouble operator+(vdouble const a, vdouble const b) { return _mm256_add_pd(a.v, b.v); }
+static inline vdouble operator-(vdouble const a, vdouble const b) { return _mm256_sub_pd(a.v, b.v); }
+static inline vdouble operator*(vdouble const a, vdouble const b) { return _mm256_mul_pd(a.v, b.v); }
+static inline vdouble operator/(vdouble const a, vdouble const b) { return _mm256_div_pd(a.v, b.v); }
+
+static inline vdouble vsqrt(vdouble const a) { return _mm256_sqrt_pd(a.v); }
+static inline vdouble vmin(vdouble const a, vdouble const b) { return _mm256_min_pd(a.v, b.v); }
+static inline vdouble vmax(vdouble const a, vdouble const b) { return _mm256_max_pd(a.v, b.v); }
+static inline vdouble vabs(vdouble const a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v); }
+
+static inline vmask vgt(vdouble const a, vdouble const b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ); }
+
+static inline vmask operator&(vmask const a, vmask const b) { return _mm256_and_pd(a.m, b.m); }
+static inline vmask vandnot(vmask const a, vmask const b) { return _mm256_andnot_pd(a.m, b.m); }
+static inline bool vany(vmask const a) { return _mm256_movemask_pd(a.m) != 0; }
+
+static inline vdouble vselect(vmask const m, vdouble const a, vdouble const b)
+{
+    return _mm256_blendv_pd(b.v, a.v, m.m);
+}
+
+#elif defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#define SIMD_WIDTH 2
+#define SIMD_NAME "sse2"
+
+struct vdouble {
+    __m128d v;
+    vdouble() {};
+    vdouble(__m128d const v): v(v) {};
+    vdouble(double const d): v(_mm_set1_pd(d)) {};
+};
+
+struct vmask {
+    __m128d m;
+    vmask() {};
+    vmask(__m128d const m): m(m) {};
+};
+
+static inline vdouble vload(double const* ptr) { return _mm_loadu_pd(ptr); }
+static inline void vstore(double* ptr, vdouble const a) { _mm_storeu_pd(ptr, a.v); }
+
+static inline vdouble operator-(vdouble const a) { return _mm_xor_pd(_mm_set1_pd(-0.0), a.v); }
+static inline vdouble operator+(vdouble const a, vdouble const b) { return _mm_add_pd(a.v, b.v); }
+static inline vdouble operator-(vdouble const a, vdouble const b) { return _mm_sub_pd(a.v, b.v); }
+static inline vdouble operator*(vdouble const a, vdouble const b) { return _mm_mul_pd(a.v, b.v); }
+static inline vdouble operator/(vdouble const a, vdouble const b) { return _mm_div_pd(a.v, b.v); }
+
+static inline vdouble vsqrt(vdouble const a) { return _mm_sqrt_pd(a.v); }
+static inline vdouble vmin(vdouble const a, vdouble const b) { return _mm_min_pd(a.v, b.v); }
+static inline vdouble vmax(vdouble const a, vdouble const b) { return _mm_max_pd(a.v, b.v); }
+static inline vdouble vabs(vdouble const a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a.v); }
+
+static inline vmask vgt(vdouble const a, vdouble const b) { return _mm_cmpgt_pd(a.v, b.v); }
+
+static inline vmask operator&(vmask const a, vmask const b) { return _mm_and_pd(a.m, b.m); }
+static inline vmask vandnot(vmask const a, vmask const b) { return _mm_andnot_pd(a.m, b.m); }
+static inline bool vany(vmask const a) { return _mm_movemask_pd(a.m) != 0; }
+
+static inline vdouble vselect(vmask const m, vdouble const a, vdouble const b)
+{
+    return _mm_or_pd(_mm_and_pd(m.m, a.v), _mm_andnot_pd(m.m, b.v));
+}
+
+#else
+
+#include <math.h>
+
+#define SIMD_WIDTH 1
+#define SIMD_NAME "scalar"
+
+struct vdouble {
+    double v;
+    vdouble() {};
+    vdouble(double const d): v(d) {};
+};
+
+struct vmask {
+    bool m;
+    vmask() {};
+    vmask(bool const m): m(m) {};
+};
+
+static inline vdouble vload(double const* ptr) { return *ptr; }
+static inline void vstore(double* ptr, vdouble const a) { *ptr = a.v; }
+
+static inline vdouble operator-(vdouble const a) { return -a.v; }
+static inline vdouble operator+(vdouble const a, vdouble const b) { return a.v + b.v; }
+static inline vdouble operator-(vdouble const a, vdouble const b) { return a.v - b.v; }
+static inline vdouble operator*(vdouble const a, vdouble const b) { return a.v * b.v; }
+static inline vdouble operator/(vdouble const a, vdouble const b) { return a.v / b.v; }
+
+static inline vdouble vsqrt(vdouble const a) { return sqrt(a.v); }
+static inline vdouble vmin(vdouble const a, vdouble const b) { return a.v < b.v ? a : b; }
+static inline vdouble vmax(vdouble const a, vdouble const b) { return a.v > b.v ? a : b; }
+static inline vdouble vabs(vdouble const a) { return fabs(a.v); }
+
+static inline vmask vgt(vdouble const a, vdouble const b) { return a.v > b.v; }
+
+static inline vmask operator&(vmask const a, vmask const b) { return a.m and b.m; }
+static inline vmask vandnot(vmask const a, vmask const b) { return not a.m and b.m; }
+static inline bool vany(vmask const a) { return a.m; }
+
+static inline vdouble vselect(vmask const m, vdouble const a, vdouble const b)
+{
+    return m.m ? a : b;
+}
+
+#endif
+
+#endif // SIMD_HH
@@ -0,0 +1,67 @@
+/* Copyright (C) 2018  István Bozsó
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAM_HH
+#define STREAM_HH
+
+#include <stddef.h>
+
+#include "satorbit.hh"
+
+/* Out-of-core evaluation of calc_azi_inc. The points are read from a raw
+ * binary file of (n, 3) rows, float64 or float32, native byte order, the
+ * results are written to a raw binary file of (n, geom_ncols(output))
+ * rows. Both files are memory mapped one chunk of rows at a time, so the
+ * resident memory does not depend on the size of the files. */
+
+// called after every chunk with the rows done so far, the total number of
+// rows and the seconds elapsed, returns true to stop
+typedef bool (*stream_progress)(void *ctx, size_t const done,
+                                size_t const total, double const elapsed);
+
+struct stream_params {
+    size_t chunk_rows;          // rounded up to a multiple of azi_inc_segment
+    bool in_float, out_float;   // float32 instead of float64 rows
+    stream_progress progress;   // may be NULL
+    void *progress_ctx;
+    
+    stream_params(size_t chunk_rows = 1 << 20, bool in_float = false,
+                  bool out_float = false, stream_progress progress = NULL,
+                  void *progress_ctx = NULL):
+                  chunk_rows(chunk_rows), in_float(in_float),
+                  out_float(out_float), progress(progress),
+                  progress_ctx(progress_ctx) {};
+};
+
+enum stream_status {
+    ss_ok = 0,
+    ss_open_in,     // input cannot be opened or mapped, see errno
+    ss_open_out,    // output cannot be created or mapped, see errno
+    ss_size,        // input size is not a multiple of the row size
+    ss_nomem,       // memory allocation failure in calc_azi_inc
+    ss_stopped      // progress returned true
+};
+
+/* Points of in_path are split at multiples of azi_inc_segment, the
+ * results are the same as those of one calc_azi_inc call on all of them
+ * (except with zd_warm_sort, that sorts within chunks). nrows receives the
+ * number of points. */
+stream_status calc_azi_inc_stream(const fit_poly& orb, char const* in_path,
+                                  char const* out_path, zd_params const& par,
+                                  bool const is_lonlat,
+                                  stream_params const& st, size_t& nrows);
+
+#endif // STREAM_HH
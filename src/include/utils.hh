@@ -21,6 +21,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "common_macros.hh"
+
 typedef const double cdouble;
 
 /*******************************
@@ -37,11 +39,16 @@ static const double WB = 6356752.3142;
 static const double E2 = 6.694380e-03;
 
 
-static const double pi = 3.14159265358979;
+// exact to double precision, every degree conversion of the module and the
+// range reduction of fastmath.hh use them
+static const double pi = 3.14159265358979323846;
 static const double pi_per_4 = pi / 4.0;
 
-static const double deg2rad = 1.745329e-02;
-static const double rad2deg = 5.729578e+01;
+static const double deg2rad = pi / 180.0;
+static const double rad2deg = 180.0 / pi;
+
+// speed of light in vacuum [m/s]
+static const double c_light = 299792458.0;
 
 
 /**************
@@ -55,6 +62,7 @@ static const double rad2deg = 5.729578e+01;
 
 
 void *operator new(size_t num);
+void *operator new[](size_t num);
 void operator delete(void *ptr);
 void operator delete[](void *ptr);
 
@@ -63,6 +71,13 @@ void operator delete[](void *ptr);
  * IO functions *
  ****************/
 
+/* Messages of print, println, error, errorln and perrorln go to the
+ * handler if one is set, to stdout / stderr otherwise. The Python module
+ * forwards them to sys.stdout / sys.stderr. */
+typedef void (*log_handler)(bool const is_error, char const* msg);
+
+void set_log_handler(log_handler handler);
+
 void print(char const* fmt, ...);
 void println(char const* fmt, ...);
 
@@ -80,15 +95,55 @@ enum status {
     fail = 1
 };
 
+
+// default size of the blocks of a Pool created with Pool()
+static const size_t pool_block_size = size_t(1) << 16;
+
+struct pool_block;
+
+// state of a Pool to return to with Pool::release
+struct pool_mark {
+    pool_block *block;
+    size_t used, in_use;
+};
+
+/* Arena for the scratch memory of a kernel call. Allocations are bumped
+ * out of one block; when it is full a new block, twice as large (or as
+ * large as the request), is chained to it. Memory is given back all at once: to a mark
+ * (release, pool_scope) or completely (reset), blocks chained after the
+ * mark are freed. Pool(num, ...) takes the sizes of the buffers needed,
+ * so the first block holds them without chaining. Not thread safe, the
+ * workers of parallel_for should only use memory allocated before.
+ *
+ * Statistics: in_use bytes allocated now (with padding), high_water the
+ * largest in_use so far, reserved bytes held in blocks, nchained the number
+ * of blocks added because the current one was full. */
 struct Pool {
-    unsigned char *storage, *ptr;
-    size_t storage_size;
+    pool_block *head;
+    size_t block_size, in_use, high_water, reserved, nchained;
     
+    Pool();
     Pool(int num, ...);
     ~Pool();
     
+    // allocates the first block, returns true on failure
     bool init();
-    void *alloc(size_t num_bytes);
+    
+    // NULL on failure, align should be a power of two
+    void *alloc(size_t num_bytes, size_t const align = mem_align);
+    
+    pool_mark mark() const;
+    void release(pool_mark const& to);
+    void reset();
+};
+
+// allocations made during the lifetime of a scope are released at its end
+struct pool_scope {
+    Pool& pool;
+    pool_mark const start;
+    
+    pool_scope(Pool& pool): pool(pool), start(pool.mark()) {};
+    ~pool_scope() { pool.release(start); }
 };
 
 
@@ -0,0 +1,217 @@
+#ifndef VECTOR_HH
+#define VECTOR_HH
+
+#include <stddef.h>
+#include <string.h>
+
+#include "array.hh"
+
+// capacity of the first allocation of vector and soa_vector
+static const size_t vector_min_cap = 8;
+
+
+/* Growable buffer for results of data dependent size. The capacity doubles
+ * when it runs out, reserve allocates ahead if the final size can be
+ * guessed. The storage comes from array_alloc, so release hands it to
+ * nparray::adopt without a final copy. Operations that allocate return
+ * true on failure, the contents are kept then. */
+template<class T>
+struct vector {
+    T *data;
+    size_t size, cap;
+    
+    vector(): data(NULL), size(0), cap(0) {};
+    
+    ~vector() {
+        array_free(data);
+        data = NULL;
+        size = cap = 0;
+    }
+    
+    #ifndef __INMET_IMPL
+    bool reserve(size_t const new_cap);
+    #else
+    
+    bool reserve(size_t const new_cap) {
+        if (new_cap <= cap)
+            return false;
+        
+        T *tmp;
+        
+        if (new_cap > size_t(-1) / 2 / sizeof(T)
+            or (tmp = (T*) array_alloc(new_cap * sizeof(T))) == NULL)
+            return true;
+        
+        if (size > 0)
+            memcpy(tmp, data, size * sizeof(T));
+        
+        array_free(data);
+        data = tmp;
+        cap = new_cap;
+        
+        return false;
+    }
+    
+    #endif
+    
+    // n uninitialized elements at the end, NULL on failure
+    T* extend(size_t const n) {
+        if (size + n > cap and grow(size + n))
+            return NULL;
+        
+        size += n;
+        return data + size - n;
+    }
+    
+    bool push(T const& elem) {
+        if (size == cap and grow(size + 1))
+            return true;
+        
+        data[size++] = elem;
+        return false;
+    }
+    
+    bool push(T const* vals, size_t const n) {
+        T *dst;
+        
+        if ((dst = extend(n)) == NULL)
+            return true;
+        
+        for(size_t ii = 0; ii < n; ++ii)
+            dst[ii] = vals[ii];
+        
+        return false;
+    }
+    
+    // keeps the storage
+    void clear() {
+        size = 0;
+    }
+    
+    // gives up the storage, it should be freed with array_free
+    T* release() {
+        T *ret = data;
+        
+        data = NULL;
+        size = cap = 0;
+        
+        return ret;
+    }
+    
+    T& operator[](size_t const index) {
+        return data[index];
+    }
+    
+    T const operator[](size_t const index) const {
+        return data[index];
+    }
+
+private:
+    bool grow(size_t const min_cap) {
+        size_t new_cap = cap > 0 ? 2 * cap : vector_min_cap;
+        
+        return reserve(new_cap > min_cap ? new_cap : min_cap);
+    }
+    
+    vector(vector const&);
+    vector& operator=(vector const&);
+};
+
+
+/* Rows of ncols values stored column by column (structure of arrays) in
+ * one buffer, column jj starts at data + jj * cap. Loops over a column
+ * read contiguous memory, the buffer is handed over as an (nrows, ncols)
+ * array with strides (1, cap) elements. Grows as vector does. */
+template<class T>
+struct soa_vector {
+    T *data;
+    size_t size, cap, ncols;
+    
+    soa_vector(size_t const ncols): data(NULL), size(0), cap(0),
+                                    ncols(ncols) {};
+    
+    ~soa_vector() {
+        array_free(data);
+        data = NULL;
+        size = cap = 0;
+    }
+    
+    #ifndef __INMET_IMPL
+    bool reserve(size_t const new_cap);
+    #else
+    
+    bool reserve(size_t const new_cap) {
+        if (new_cap <= cap)
+            return false;
+        
+        T *tmp;
+        
+        if (new_cap > size_t(-1) / 2 / sizeof(T) / ncols
+            or (tmp = (T*) array_alloc(ncols * new_cap * sizeof(T))) == NULL)
+            return true;
+        
+        // columns move to their new offsets
+        if (size > 0) {
+            for(size_t jj = 0; jj < ncols; ++jj)
+                memcpy(tmp + jj * new_cap, data + jj * cap, size * sizeof(T));
+        }
+        
+        array_free(data);
+        data = tmp;
+        cap = new_cap;
+        
+        return false;
+    }
+    
+    #endif
+    
+    // row of ncols values
+    bool push(T const* row) {
+        if (size == cap and grow(size + 1))
+            return true;
+        
+        for(size_t jj = 0; jj < ncols; ++jj)
+            data[jj * cap + size] = row[jj];
+        
+        size++;
+        return false;
+    }
+    
+    T* column(size_t const jj) {
+        return data + jj * cap;
+    }
+    
+    void clear() {
+        size = 0;
+    }
+    
+    // gives up the storage, it should be freed with array_free
+    T* release() {
+        T *ret = data;
+        
+        data = NULL;
+        size = cap = 0;
+        
+        return ret;
+    }
+    
+    T& operator()(size_t const ii, size_t const jj) {
+        return data[jj * cap + ii];
+    }
+    
+    T const operator()(size_t const ii, size_t const jj) const {
+        return data[jj * cap + ii];
+    }
+
+private:
+    bool grow(size_t const min_cap) {
+        size_t new_cap = cap > 0 ? 2 * cap : vector_min_cap;
+        
+        return reserve(new_cap > min_cap ? new_cap : min_cap);
+    }
+    
+    soa_vector(soa_vector const&);
+    soa_vector& operator=(soa_vector const&);
+};
+
+#endif
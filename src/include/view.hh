@@ -3,8 +3,9 @@
 
 #include <stddef.h>
 
-#include "nparray.hh"
-
+/* view does not depend on the Python runtime. Arrays of the bindings
+ * (e.g. nparray) are viewed through data(), ndim, shape and strides
+ * (in elements). */
 template<class T>
 struct view {
     T * data;
@@ -14,8 +15,9 @@ struct view {
     view(T *data, size_t ndim, size_t *shape, size_t *strides):
          data(data), ndim(ndim), shape(shape), strides(strides) {};
 
-    view(nparray const& arr): data((T*) PyArray_DATA(arr.npobj)), ndim(arr.ndim),
-                              shape(arr.shape), strides(arr.strides) {};
+    template<class Arr>
+    explicit view(Arr const& arr): data((T*) arr.data()), ndim(arr.ndim),
+                                   shape(arr.shape), strides(arr.strides) {};
     
     ~view() {};
 
@@ -82,7 +84,137 @@ struct view {
         return data[  ii * strides[0] + jj * strides[1] + kk * strides[2]
                     + ll * strides[3]];
     }
+    
+    // unit stride along the last axis
+    bool is_contiguous() const {
+        return ndim == 0 or strides[ndim - 1] == 1;
+    }
+};
+
+
+/* Layouts of fview: the offset of an index along the last axis. Elements
+ * of a contiguous view are next to each other along the last axis, the
+ * index is not multiplied by a stride there. */
+struct strided {
+    static size_t offset(size_t const idx, size_t const stride) {
+        return idx * stride;
+    }
+};
+
+struct contiguous {
+    static size_t offset(size_t const idx, size_t const) {
+        return idx;
+    }
+};
+
+
+/* view with its rank N and layout fixed at compile time, shape and strides
+ * are held in place. Kernels are written as templates over the array type
+ * and entry points dispatch once, e.g. to fview<double, 2, contiguous> if
+ * view::is_contiguous, to real_view otherwise. set() and the const
+ * operator() read and write doubles as real_view does. */
+template<class T, size_t N, class Layout = strided>
+struct fview {
+    T *data;
+    size_t shape[N], strides[N];
+    
+    fview(): data(NULL) {};
+    
+    // arr should have rank N and, for contiguous, unit stride along
+    // the last axis
+    explicit fview(view<T> const& arr): data(arr.data) {
+        for(size_t ii = 0; ii < N; ++ii) {
+            shape[ii] = arr.shape[ii];
+            strides[ii] = arr.strides[ii];
+        }
+    }
+    
+    T& operator()(size_t const ii) {
+        return data[Layout::offset(ii, strides[0])];
+    }
+    
+    T& operator()(size_t const ii, size_t const jj) {
+        return data[ii * strides[0] + Layout::offset(jj, strides[1])];
+    }
+    
+    T& operator()(size_t const ii, size_t const jj, size_t const kk) {
+        return data[  ii * strides[0] + jj * strides[1]
+                    + Layout::offset(kk, strides[2])];
+    }
+    
+    double operator()(size_t const ii) const {
+        return double(data[Layout::offset(ii, strides[0])]);
+    }
+    
+    double operator()(size_t const ii, size_t const jj) const {
+        return double(data[ii * strides[0] + Layout::offset(jj, strides[1])]);
+    }
+    
+    double operator()(size_t const ii, size_t const jj,
+                      size_t const kk) const {
+        return double(data[  ii * strides[0] + jj * strides[1]
+                           + Layout::offset(kk, strides[2])]);
+    }
+    
+    void set(size_t const ii, double const value) {
+        (*this)(ii) = T(value);
+    }
+    
+    void set(size_t const ii, size_t const jj, double const value) {
+        (*this)(ii, jj) = T(value);
+    }
+};
+
 
+/* A float64 or a float32 array of at most two dimensions, elements are
+ * read and written as double. The kernels take float32 input and output
+ * through it without converting whole arrays, an element costs one well
+ * predicted branch. */
+struct real_view {
+    view<double> dbl;
+    view<float> flt;
+    bool is_float;
+    size_t ndim, *shape;
+    
+    real_view(): is_float(false), ndim(0), shape(NULL) {};
+    
+    real_view(view<double> const& arr):
+              dbl(arr), is_float(false), ndim(arr.ndim), shape(arr.shape) {};
+    
+    real_view(view<float> const& arr):
+              flt(arr), is_float(true), ndim(arr.ndim), shape(arr.shape) {};
+    
+    // arrays of the bindings, is_float() tells their type
+    template<class Arr>
+    explicit real_view(Arr const& arr):
+              dbl(arr), flt(arr), is_float(arr.is_float()),
+              ndim(arr.ndim), shape(arr.shape) {};
+    
+    double operator()(size_t const ii) const {
+        return is_float ? double(flt(ii)) : dbl(ii);
+    }
+    
+    double operator()(size_t const ii, size_t const jj) const {
+        return is_float ? double(flt(ii, jj)) : dbl(ii, jj);
+    }
+    
+    bool is_contiguous() const {
+        return is_float ? flt.is_contiguous() : dbl.is_contiguous();
+    }
+    
+    void set(size_t const ii, double const value) {
+        if (is_float)
+            flt(ii) = float(value);
+        else
+            dbl(ii) = value;
+    }
+    
+    void set(size_t const ii, size_t const jj, double const value) {
+        if (is_float)
+            flt(ii, jj) = float(value);
+        else
+            dbl(ii, jj) = value;
+    }
 };
 
 #endif
@@ -1,208 +1,1625 @@
+#define INMET_AUX_MODULE
+
+#include <float.h>
+#include <math.h>
+#include <time.h>
+
 #include "pymacros.hh"
 #include "nparray.hh"
 #include "view.hh"
 #include "array.hh"
+#include "vector.hh"
 #include "satorbit.hh"
+#include "stream.hh"
 #include "utils.hh"
 
 
-typedef PyArrayObject* np_ptr;
-typedef PyObject* py_ptr;
+typedef PyArrayObject* np_ptr;
+typedef PyObject* py_ptr;
+
+
+// float32 arrays are used as they are, anything else is converted to double
+static int real_type(PyObject *obj)
+{
+    if (obj != NULL and PyArray_Check(obj)
+        and PyArray_TYPE((PyArrayObject*) obj) == NPY_FLOAT)
+        return dt_float;
+    
+    return dt_double;
+}
+
+static int real_type(nparray const& arr)
+{
+    return real_type(arr.pyobj);
+}
+
+
+// out if it is given (not NULL or None), a new (rows, cols) array of
+// typenum otherwise
+static bool output_array(nparray& arr, PyObject *out, size_t const rows,
+                         size_t const cols, int const typenum = dt_double)
+{
+    if (out == NULL or out == Py_None)
+        return arr.empty(typenum, 0, 2, rows, cols);
+    
+    return arr.import_out(typenum, 2, out) or arr.check_rows(rows)
+           or arr.check_cols(cols);
+}
+
+
+// fit_poly reads mean_coords through a plain pointer, so the three values
+// are copied out of a possibly strided array
+static bool import_mean_coords(nparray& arr, double mean_coords[3])
+{
+    if (arr.import(dt_double, 1) or arr.check_rows(3))
+        return true;
+    
+    view<npy_double> mc(arr);
+    
+    FOR(ii, 3)
+        mean_coords[ii] = mc(ii);
+    
+    return false;
+}
+
+
+// false for NaN and inf as well
+static inline bool positive(double const x)
+{
+    return x > 0.0 and isfinite(x);
+}
+
+
+// coefficients of an orbit polynom of deg, (3, deg + 1)
+static bool import_coeffs(nparray& arr, uint const deg)
+{
+    return arr.import(dt_double, 2) or arr.check_rows(3)
+           or arr.check_cols(size_t(deg) + 1);
+}
+
+// basis and degree of an orbit polynom
+static bool check_basis(uint const basis, uint const deg)
+{
+    if (basis > basis_chebyshev) {
+        PyErr_Format(PyExc_ValueError, "basis should be 0 (power) or "
+                     "1 (Chebyshev) not %u!", basis);
+        return true;
+    }
+    
+    if (basis == basis_chebyshev and deg > max_cheb_deg) {
+        PyErr_Format(PyExc_ValueError, "Degree of a Chebyshev orbit should "
+                     "be at most %u not %u!", uint(max_cheb_deg), deg);
+        return true;
+    }
+    
+    return false;
+}
+
+
+// basis, degree and time window of an orbit polynom
+static bool check_basis(uint const basis, uint const deg, double const start_t,
+                        double const stop_t)
+{
+    if (check_basis(basis, deg))
+        return true;
+    
+    if (basis == basis_chebyshev and not (stop_t > start_t)) {
+        PyErr_Format(PyExc_ValueError, "stop_t should be greater than "
+                     "start_t for a Chebyshev orbit!");
+        return true;
+    }
+    
+    return false;
+}
+
+
+// output of the zero-Doppler functions, float32: single precision results
+static bool check_output(uint const output, bool const float32)
+{
+    if (output > go_radar) {
+        PyErr_Format(PyExc_ValueError, "output should be 0 (angles), "
+                     "1 (LOS unit vector), 2 (LOS unit vector and range), "
+                     "3 (angles and range) or 4 (radar) not %u!", output);
+        return true;
+    }
+    
+    // float32 zero-Doppler times would be off by several lines
+    if (float32 and output == go_radar) {
+        PyErr_Format(PyExc_ValueError, "output 4 (radar) is only available "
+                     "in double precision!");
+        return true;
+    }
+    
+    return false;
+}
+
+
+// iteration limit and solver of the zero-Doppler search, its seeding
+static bool check_solver(uint const max_iter, uint const solver,
+                         uint const warm_start)
+{
+    if (max_iter == 0) {
+        PyErr_Format(PyExc_ValueError, "max_iter should be positive!");
+        return true;
+    }
+    
+    if (solver > zd_halley) {
+        PyErr_Format(PyExc_ValueError, "solver should be 0 (bisection), "
+                     "1 (Newton) or 2 (Halley) not %u!", solver);
+        return true;
+    }
+    
+    if (warm_start > zd_warm_sort) {
+        PyErr_Format(PyExc_ValueError, "warm_start should be 0 (off), "
+                     "1 (points are sorted along-track) or 2 (sort points) "
+                     "not %u!", warm_start);
+        return true;
+    }
+    
+    return false;
+}
+
+
+pydoc(ell_to_merc, "ell_to_merc");
+
+static py_ptr ell_to_merc(py_keywords)
+{
+    keywords("lon", "lat", "lon0", "a", "e", "isdeg", "fast", "fast_math",
+             "float32", "out");
+    
+    nparray _lon, _lat;
+    PyObject *out = NULL;
+    double a, e, lon0;
+    uint isdeg, fast, fast_math = 0, float32 = 0;
+
+    parse_keywords("OOdddII|IIO:ell_to_merc", array_type(_lon),
+                   array_type(_lat), &lon0, &a, &e, &isdeg, &fast, &fast_math,
+                   &float32, &out);
+
+    if (_lon.import(real_type(_lon), 1) or _lat.import(real_type(_lat), 1))
+        return NULL;
+    
+    size_t rows = _lon.shape[0];
+    if (_lat.check_rows(rows))
+        return NULL;
+    
+    nparray _xy;
+    
+    // the dtype of out, if given, overrides float32
+    if (output_array(_xy, out, rows, 2,
+                     float32 or real_type(out) == dt_float ? dt_float
+                                                           : dt_double))
+        return NULL;
+    
+    real_view lon(_lon), lat(_lat), xy(_xy);
+    
+    // fast: projection of the sphere
+    Py_BEGIN_ALLOW_THREADS
+    calc_ell_merc(lon, lat, xy, lon0, a, fast ? 0.0 : e, isdeg, fast_math);
+    Py_END_ALLOW_THREADS
+    
+    return Py_BuildValue("N", _xy.ret());
+}
+
+
+pydoc(test, "test");
+
+static py_ptr test(py_varargs)
+{
+    nparray _arr;
+    parse_varargs("O", array_type(_arr));
+
+    if (_arr.import(dt_double, 1))
+        return NULL;
+    
+    view<npy_double> arr(_arr);
+    
+    FORZ(ii, arr.shape[0])
+        printf("%lf ", arr(ii));
+
+    printf("\n");
+
+    Py_RETURN_NONE;
+}
+
+
+// arguments of azi_inc after the orbit, shared with Orbit.azi_inc
+struct azi_inc_args {
+    uint is_lonlat, max_iter, solver, return_niter, warm_start, nthreads,
+         fast_math, output, float32;
+    lut_params lut;
+    sar_params sar;
+    nparray _coords;
+    PyObject *out;
+    
+    azi_inc_args(): is_lonlat(1), max_iter(1000), solver(zd_bisect),
+                    return_niter(0), warm_start(zd_cold), nthreads(1),
+                    fast_math(0), output(go_angles), float32(0),
+                    lut(0.0, 0.0, 0.0), sar(0.0, 0.0, 0.0, 0.0), out(NULL) {};
+};
+
+
+static py_ptr run_azi_inc(const fit_poly& orb, azi_inc_args& arg)
+{
+    double lut_err[2];
+    lut_params const& lut = arg.lut;
+    sar_params const& sar = arg.sar;
+    uint const output = arg.output, solver = arg.solver,
+               warm_start = arg.warm_start;
+    
+    nparray _azi_inc, _niter, _line_pixel;
+    
+    // the dtype of out, if given, overrides float32
+    if (real_type(arg.out) == dt_float)
+        arg.float32 = 1;
+    
+    bool use_lut = lut.dlon != 0.0 or lut.dlat != 0.0 or lut.dh != 0.0,
+         use_sar = sar.prf != 0.0 or sar.rsr != 0.0;
+    
+    if (use_lut and (not positive(lut.dlon) or not positive(lut.dlat)
+                     or not positive(lut.dh))) {
+        PyErr_Format(PyExc_ValueError, "lut_step (dlon, dlat, dh) should "
+                     "be positive and finite!");
+        return NULL;
+    }
+    
+    if (use_lut and arg.return_niter) {
+        PyErr_Format(PyExc_ValueError, "Iteration numbers are not available "
+                     "in lookup table mode!");
+        return NULL;
+    }
+    
+    if (check_output(output, arg.float32)
+        or check_solver(arg.max_iter, solver, warm_start))
+        return NULL;
+    
+    if (use_sar and (output != go_radar or sar.prf <= 0.0
+                     or sar.rsr <= 0.0)) {
+        PyErr_Format(PyExc_ValueError, "sar (t_first, prf, near_range, rsr) "
+                     "needs output 4 (radar) and positive prf and rsr!");
+        return NULL;
+    }
+    
+    if (use_lut and output != go_angles) {
+        PyErr_Format(PyExc_ValueError, "Only angles are available in lookup "
+                     "table mode!");
+        return NULL;
+    }
+    
+    nparray& _coords = arg._coords;
+    
+    if (_coords.import(real_type(_coords), 2) or _coords.check_cols(3))
+        return NULL;
+    
+    if (output_array(_azi_inc, arg.out, _coords.shape[0],
+                     geom_ncols(geom_output(output)),
+                     arg.float32 ? dt_float : dt_double))
+        return NULL;
+    
+    if (arg.return_niter and _niter.empty(dt_int, 0, 1, _coords.shape[0]))
+        return NULL;
+    
+    if (use_sar and _line_pixel.empty(dt_double, 0, 2, _coords.shape[0],
+                                      size_t(2)))
+        return NULL;
+    
+    real_view coords(_coords), azi_inc(_azi_inc), line_pixel;
+    view<int> niter;
+    
+    if (arg.return_niter)
+        niter = view<int>(_niter);
+    
+    if (use_sar)
+        line_pixel = real_view(_line_pixel);
+    
+    zd_params par(arg.max_iter, zd_solver(solver), zd_seed(warm_start),
+                  arg.nthreads, arg.fast_math, geom_output(output));
+    bool const is_lonlat = arg.is_lonlat;
+    lut_status status = lut_ok;
+    bool fail;
+    
+    Py_BEGIN_ALLOW_THREADS
+    if (use_lut)
+        fail = (status = calc_azi_inc_lut(orb, coords, azi_inc, par,
+                                          is_lonlat, lut, lut_err)) != lut_ok;
+    else
+        fail = calc_azi_inc(orb, coords, azi_inc, par, is_lonlat,
+                            arg.return_niter ? &niter : NULL);
+    
+    if (not fail and use_sar)
+        calc_line_pixel(azi_inc, line_pixel, sar);
+    Py_END_ALLOW_THREADS
+    
+    if (status == lut_too_large) {
+        PyErr_Format(PyExc_ValueError, "lut_step is too small for the extent "
+                     "of coords, the lookup table would have more than %zu "
+                     "nodes!", lut_max_node);
+        return NULL;
+    }
+    
+    if (fail)
+        return PyErr_NoMemory();
+    
+    if (use_lut)
+        return Py_BuildValue("N(dd)", _azi_inc.ret(), lut_err[0], lut_err[1]);
+    
+    if (use_sar and arg.return_niter)
+        return Py_BuildValue("NNN", _azi_inc.ret(), _line_pixel.ret(),
+                             _niter.ret());
+    
+    if (use_sar)
+        return Py_BuildValue("NN", _azi_inc.ret(), _line_pixel.ret());
+    
+    if (arg.return_niter)
+        return Py_BuildValue("NN", _azi_inc.ret(), _niter.ret());
+    
+    return Py_BuildValue("N", _azi_inc.ret());
+} // run_azi_inc
+
+
+pydoc(azi_inc, "azi_inc");
+
+static py_ptr azi_inc(py_keywords)
+{
+    keywords("mean_t", "start_t", "stop_t", "is_centered", "deg",
+             "mean_coords", "coeffs", "coords", "is_lonlat", "max_iter",
+             "solver", "return_niter", "warm_start", "nthreads", "lut_step",
+             "basis", "fast_math", "output", "sar", "float32", "out");
+    
+    double mean_t = 0.0, start_t = 0.0, stop_t = 0.0, mean_coords[3];
+    uint is_centered = 0, deg = 0, basis = basis_power;
+    
+    azi_inc_args arg;
+    nparray _mean_coords, _coeffs;
+    
+    parse_keywords("dddIIOOOII|IIII(ddd)III(dddd)IO:azi_inc", &mean_t,
+                   &start_t, &stop_t, &is_centered, &deg,
+                   array_type(_mean_coords), array_type(_coeffs),
+                   array_type(arg._coords), &arg.is_lonlat, &arg.max_iter,
+                   &arg.solver, &arg.return_niter, &arg.warm_start,
+                   &arg.nthreads, &arg.lut.dlon, &arg.lut.dlat, &arg.lut.dh,
+                   &basis, &arg.fast_math, &arg.output, &arg.sar.t_first,
+                   &arg.sar.prf, &arg.sar.near_range, &arg.sar.rsr,
+                   &arg.float32, &arg.out);
+    
+    if (check_basis(basis, deg, start_t, stop_t))
+        return NULL;
+    
+    if (import_mean_coords(_mean_coords, mean_coords)
+        or import_coeffs(_coeffs, deg))
+        return NULL;
+    
+    view<npy_double> coeffs(_coeffs);
+    
+    // Set up orbit polynomial structure
+    fit_poly orb(mean_t, start_t, stop_t,
+                mean_coords, coeffs, is_centered,
+                deg, poly_basis(basis));
+    
+    return run_azi_inc(orb, arg);
+} // azi_inc
+
+
+pydoc(azi_inc_multi, "azi_inc_multi");
+
+static py_ptr azi_inc_multi(py_keywords)
+{
+    keywords("mean_t", "start_t", "stop_t", "is_centered", "deg",
+             "mean_coords", "coeffs", "coords", "is_lonlat", "max_iter",
+             "solver", "warm_start", "nthreads", "basis", "fast_math",
+             "output", "master");
+    
+    uint is_centered = 0, deg = 0, is_lonlat = 0, max_iter = 0,
+         solver = zd_bisect, warm_start = zd_cold, nthreads = 1,
+         basis = basis_power, fast_math = 0, output = go_angles;
+    
+    // index of the orbit whose solution seeds the others, -1: none
+    int master = -1;
+    
+    nparray _mean_t, _start_t, _stop_t, _mean_coords, _coeffs, _coords,
+            _azi_inc;
+    
+    parse_keywords("OOOIIOOOII|IIIIIIi:azi_inc_multi", array_type(_mean_t),
+                   array_type(_start_t), array_type(_stop_t), &is_centered,
+                   &deg, array_type(_mean_coords), array_type(_coeffs),
+                   array_type(_coords), &is_lonlat, &max_iter, &solver,
+                   &warm_start, &nthreads, &basis, &fast_math, &output,
+                   &master);
+    
+    if (check_output(output, false)
+        or check_solver(max_iter, solver, warm_start)
+        or check_basis(basis, deg))
+        return NULL;
+    
+    if (_mean_t.import(dt_double, 1) or _start_t.import(dt_double, 1)
+        or _stop_t.import(dt_double, 1) or _mean_coords.import(dt_double, 2)
+        or _coeffs.import(dt_double, 3) or _coords.import(dt_double, 2))
+        return NULL;
+    
+    size_t norb = _coeffs.shape[0];
+    
+    if (_coeffs.shape[1] != 3 or _coeffs.shape[2] != deg + 1) {
+        PyErr_Format(PyExc_ValueError, "coeffs should have a shape of "
+                     "(n_orbits, 3, %u)!", deg + 1);
+        return NULL;
+    }
+    
+    if (_mean_t.check_rows(norb) or _start_t.check_rows(norb)
+        or _stop_t.check_rows(norb) or _mean_coords.check_rows(norb)
+        or _mean_coords.check_cols(3) or _coords.check_cols(3))
+        return NULL;
+    
+    if (master >= int(norb)) {
+        PyErr_Format(PyExc_ValueError, "master should be less than the "
+                     "number of orbits (%u) not %d!", uint(norb), master);
+        return NULL;
+    }
+    
+    view<npy_double> mean_t(_mean_t), start_t(_start_t), stop_t(_stop_t),
+                     mean_coords(_mean_coords), coeffs(_coeffs),
+                     coords(_coords);
+    
+    FOR(ii, norb) {
+        if (check_basis(basis, deg, start_t(ii), stop_t(ii)))
+            return NULL;
+    }
+    
+    if (_azi_inc.empty(dt_double, 0, 3, _coords.shape[0], norb,
+                       geom_ncols(geom_output(output))))
+        return NULL;
+    
+    view<npy_double> azi_inc(_azi_inc);
+    
+    orbit_stack orbs(mean_t, start_t, stop_t, mean_coords, coeffs,
+                     is_centered, deg, poly_basis(basis));
+    
+    zd_params par(max_iter, zd_solver(solver), zd_seed(warm_start), nthreads,
+                  fast_math, geom_output(output));
+    bool fail;
+    
+    Py_BEGIN_ALLOW_THREADS
+    if (master < 0)
+        fail = calc_azi_inc_multi(orbs, coords, azi_inc, par, is_lonlat);
+    else
+        fail = calc_azi_inc_dates(orbs, size_t(master), coords, azi_inc, par,
+                                  is_lonlat);
+    Py_END_ALLOW_THREADS
+    
+    if (fail)
+        return PyErr_NoMemory();
+    
+    return Py_BuildValue("N", _azi_inc.ret());
+} // azi_inc_multi
+
+
+// progress of azi_inc_file, ctx is the Python callable or NULL
+static bool stream_report(void *ctx, size_t const done, size_t const total,
+                          double const elapsed)
+{
+    PyGILState_STATE gil = PyGILState_Ensure();
+    
+    // Ctrl-C stops the computation after the current chunk
+    bool stop = PyErr_CheckSignals() != 0;
+    
+    if (not stop and ctx != NULL) {
+        PyObject *ret = PyObject_CallFunction((PyObject*) ctx, "nnd",
+                                              Py_ssize_t(done),
+                                              Py_ssize_t(total), elapsed);
+        stop = ret == NULL;
+        Py_XDECREF(ret);
+    }
+    
+    PyGILState_Release(gil);
+    return stop;
+}
+
+
+pydoc(azi_inc_file, "azi_inc_file");
+
+static py_ptr azi_inc_file(py_keywords)
+{
+    keywords("mean_t", "start_t", "stop_t", "is_centered", "deg",
+             "mean_coords", "coeffs", "in_path", "out_path", "is_lonlat",
+             "max_iter", "solver", "warm_start", "nthreads", "basis",
+             "fast_math", "output", "float32_in", "float32_out",
+             "chunk_rows", "progress");
+    
+    double mean_t = 0.0, start_t = 0.0, stop_t = 0.0, mean_coords[3];
+    uint is_centered = 0, deg = 0, is_lonlat = 0, max_iter = 0,
+         solver = zd_bisect, warm_start = zd_cold, nthreads = 1,
+         basis = basis_power, fast_math = 0, output = go_angles,
+         float32_in = 0, float32_out = 0, chunk_rows = 1 << 20;
+    char const *in_path = NULL, *out_path = NULL;
+    PyObject *progress = NULL;
+    
+    nparray _mean_coords, _coeffs;
+    
+    parse_keywords("dddIIOOssII|IIIIIIIIIO:azi_inc_file", &mean_t, &start_t,
+                   &stop_t, &is_centered, &deg, array_type(_mean_coords),
+                   array_type(_coeffs), &in_path, &out_path, &is_lonlat,
+                   &max_iter, &solver, &warm_start, &nthreads, &basis,
+                   &fast_math, &output, &float32_in, &float32_out,
+                   &chunk_rows, &progress);
+    
+    if (progress == Py_None)
+        progress = NULL;
+    
+    if (progress != NULL and not PyCallable_Check(progress)) {
+        PyErr_Format(PyExc_TypeError, "progress should be callable!");
+        return NULL;
+    }
+    
+    if (check_output(output, float32_out)
+        or check_solver(max_iter, solver, warm_start)
+        or check_basis(basis, deg, start_t, stop_t))
+        return NULL;
+    
+    if (import_mean_coords(_mean_coords, mean_coords)
+        or import_coeffs(_coeffs, deg))
+        return NULL;
+    
+    view<npy_double> coeffs(_coeffs);
+    
+    fit_poly orb(mean_t, start_t, stop_t,
+                mean_coords, coeffs, is_centered,
+                deg, poly_basis(basis));
+    
+    zd_params par(max_iter, zd_solver(solver), zd_seed(warm_start), nthreads,
+                  fast_math, geom_output(output));
+    
+    stream_params st(chunk_rows, float32_in, float32_out, stream_report,
+                     progress);
+    
+    stream_status status;
+    size_t nrows;
+    timespec start;
+    
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    Py_BEGIN_ALLOW_THREADS
+    status = calc_azi_inc_stream(orb, in_path, out_path, par, is_lonlat, st,
+                                 nrows);
+    Py_END_ALLOW_THREADS
+    
+    switch (status) {
+        case ss_open_in:
+            return PyErr_SetFromErrnoWithFilename(PyExc_IOError, in_path);
+        case ss_open_out:
+            return PyErr_SetFromErrnoWithFilename(PyExc_IOError, out_path);
+        case ss_size:
+            PyErr_Format(PyExc_ValueError, "Size of %s is not a multiple of "
+                         "the size of a (3 column) row!", in_path);
+            return NULL;
+        case ss_nomem:
+            return PyErr_NoMemory();
+        case ss_stopped:
+            return NULL;
+        default:
+            break;
+    }
+    
+    timespec stop;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    
+    return Py_BuildValue("nd", Py_ssize_t(nrows),
+                         double(stop.tv_sec - start.tv_sec)
+                         + 1e-9 * double(stop.tv_nsec - start.tv_nsec));
+} // azi_inc_file
+
+
+pydoc(geocode, "geocode");
+
+static py_ptr geocode(py_keywords)
+{
+    keywords("mean_t", "start_t", "stop_t", "is_centered", "deg",
+             "mean_coords", "coeffs", "sar", "radar", "shape", "raster",
+             "is_line_pixel", "dem", "dem_geo", "h0", "look_right",
+             "max_iter", "tol", "nthreads", "basis");
+    
+    double mean_t = 0.0, start_t = 0.0, stop_t = 0.0, lon_first = 0.0,
+           lat_first = 0.0, dlon = 0.0, dlat = 0.0, h0 = 0.0, tol = 1e-3,
+           mean_coords[3];
+    uint is_centered = 0, deg = 0, nrow = 0, ncol = 0, is_line_pixel = 1,
+         look_right = 1, max_iter = 20, nthreads = 1, basis = basis_power;
+    
+    sar_params sar(0.0, 0.0, 0.0, 0.0);
+    raster_params raster;
+    
+    nparray _mean_coords, _coeffs, _radar, _dem, _ell;
+    
+    parse_keywords("dddIIOO(dddd)|O(II)(dddd)IO(dddd)dIIdII:geocode",
+                   &mean_t, &start_t, &stop_t, &is_centered, &deg,
+                   array_type(_mean_coords), array_type(_coeffs),
+                   &sar.t_first, &sar.prf, &sar.near_range, &sar.rsr,
+                   array_type(_radar), &nrow, &ncol, &raster.first_line,
+                   &raster.first_pixel, &raster.line_step,
+                   &raster.pixel_step, &is_line_pixel, array_type(_dem),
+                   &lon_first, &lat_first, &dlon, &dlat, &h0, &look_right,
+                   &max_iter, &tol, &nthreads, &basis);
+    
+    bool use_radar = _radar.pyobj != NULL and _radar.pyobj != Py_None,
+         use_dem = _dem.pyobj != NULL and _dem.pyobj != Py_None;
+    
+    if (use_radar == (nrow > 0 and ncol > 0)) {
+        PyErr_Format(PyExc_ValueError, "Either radar coordinates or the "
+                     "shape (nrow, ncol) of a raster should be given!");
+        return NULL;
+    }
+    
+    if ((not use_radar or is_line_pixel)
+        and (sar.prf <= 0.0 or sar.rsr <= 0.0)) {
+        PyErr_Format(PyExc_ValueError, "sar (t_first, prf, near_range, rsr) "
+                     "should have positive prf and rsr!");
+        return NULL;
+    }
+    
+    if (use_dem and (not isfinite(lon_first) or not isfinite(lat_first)
+                     or not positive(fabs(dlon))
+                     or not positive(fabs(dlat)))) {
+        PyErr_Format(PyExc_ValueError, "dem_geo (lon_first, lat_first, "
+                     "dlon, dlat) should be finite with nonzero spacing!");
+        return NULL;
+    }
+    
+    if (max_iter == 0 or not (tol > 0.0)) {
+        PyErr_Format(PyExc_ValueError, "max_iter and tol should be "
+                     "positive!");
+        return NULL;
+    }
+    
+    if (check_basis(basis, deg, start_t, stop_t))
+        return NULL;
+    
+    if (import_mean_coords(_mean_coords, mean_coords)
+        or import_coeffs(_coeffs, deg))
+        return NULL;
+    
+    if (use_radar and (_radar.import(dt_double, 2) or _radar.check_cols(2)))
+        return NULL;
+    
+    if (use_dem and _dem.import(dt_double, 2))
+        return NULL;
+    
+    if (use_dem and (_dem.shape[0] < 2 or _dem.shape[1] < 2)) {
+        PyErr_Format(PyExc_ValueError, "dem should have at least 2 rows "
+                     "and 2 columns!");
+        return NULL;
+    }
+    
+    if (use_radar)
+        nrow = _radar.shape[0];
+    
+    // points: (n, 3), seen by calc_geocode as (n, 1, 3)
+    if (use_radar ? _ell.empty(dt_double, 0, 2, size_t(nrow), size_t(3))
+                  : _ell.empty(dt_double, 0, 3, size_t(nrow), size_t(ncol),
+                               size_t(3)))
+        return NULL;
+    
+    size_t shape[3] = {nrow, 1, 3},
+           strides[3] = {_ell.strides[0], 0, _ell.strides[1]};
+    
+    view<npy_double> coeffs(_coeffs), ell(_ell), radar, height;
+    
+    if (use_radar) {
+        ell = view<npy_double>((npy_double*) _ell.data(), 3, shape, strides);
+        radar = view<npy_double>(_radar);
+    }
+    
+    if (use_dem)
+        height = view<npy_double>(_dem);
+    
+    fit_poly orb(mean_t, start_t, stop_t,
+                mean_coords, coeffs, is_centered,
+                deg, poly_basis(basis));
+    
+    dem_grid dem(use_dem ? &height : NULL, lon_first, lat_first, dlon, dlat,
+                 h0);
+    geocode_params par(max_iter, tol, look_right, nthreads);
+    
+    Py_BEGIN_ALLOW_THREADS
+    calc_geocode(orb, use_radar ? &radar : NULL, is_line_pixel, raster, sar,
+                 dem, ell, par);
+    Py_END_ALLOW_THREADS
+    
+    return Py_BuildValue("N", _ell.ret());
+} // geocode
+
+
+pydoc(ell_to_cart, "ell_to_cart");
+
+static py_ptr ell_to_cart(py_keywords)
+{
+    keywords("coords", "out", "is_deg", "nthreads", "fast_math");
+    
+    nparray _ell, _xyz;
+    PyObject *out = NULL;
+    uint is_deg = 1, nthreads = 1, fast_math = 0;
+    
+    parse_keywords("O|OIII:ell_to_cart", array_type(_ell), &out, &is_deg,
+                   &nthreads, &fast_math);
+    
+    if (_ell.import(dt_double, 2) or _ell.check_cols(3))
+        return NULL;
+    
+    if (output_array(_xyz, out, _ell.shape[0], 3))
+        return NULL;
+    
+    view<npy_double> ell(_ell), xyz(_xyz);
+    
+    Py_BEGIN_ALLOW_THREADS
+    calc_ell_cart(ell, xyz, is_deg, nthreads, fast_math);
+    Py_END_ALLOW_THREADS
+    
+    return Py_BuildValue("N", _xyz.ret());
+} // ell_to_cart
+
+
+pydoc(cart_to_ell, "cart_to_ell");
+
+static py_ptr cart_to_ell(py_keywords)
+{
+    keywords("coords", "out", "is_deg", "method", "nthreads");
+    
+    nparray _xyz, _ell;
+    PyObject *out = NULL;
+    uint is_deg = 1, method = ce_bowring, nthreads = 1;
+    
+    parse_keywords("O|OIII:cart_to_ell", array_type(_xyz), &out, &is_deg,
+                   &method, &nthreads);
+    
+    if (method > ce_exact) {
+        PyErr_Format(PyExc_ValueError, "method should be 0 (Bowring), "
+                     "1 (fast Bowring) or 2 (exact) not %u!", method);
+        return NULL;
+    }
+    
+    if (_xyz.import(dt_double, 2) or _xyz.check_cols(3))
+        return NULL;
+    
+    if (output_array(_ell, out, _xyz.shape[0], 3))
+        return NULL;
+    
+    view<npy_double> xyz(_xyz), ell(_ell);
+    
+    Py_BEGIN_ALLOW_THREADS
+    calc_cart_ell(xyz, ell, cart_ell_method(method), is_deg, nthreads);
+    Py_END_ALLOW_THREADS
+    
+    return Py_BuildValue("N", _ell.ret());
+} // cart_to_ell
+
+
+/* Uniform grid over lon, lat with cells of size cell, the cells are hashed
+ * into mask + 1 buckets. The points of bucket b are at rows start[b] to
+ * start[b + 1] - 1 of lonlat. Cell 0, 0 starts at lon0, lat0 (the corner
+ * of the bounding box of the points), there are nlon x nlat cells. Points
+ * closer than cell to each other are in the same or in neighbouring cells;
+ * bucket collisions only add candidates. */
+struct point_grid {
+    double lon0, lat0, cell;
+    ptrdiff_t nlon, nlat;
+    size_t mask, *start;
+    double *lonlat;     // (n, 2)
+};
+
+
+/* Cell index of x clamped to [lo, hi]. Points of the grid are clamped to
+ * its cells, queries to one cell around it: a query further out has no
+ * neighbour in the grid, searching next to the border loses nothing. NaN
+ * (from an overflowing extent, when the grid is one cell) goes to lo. */
+static inline ptrdiff_t grid_coord(double const x, double const x0,
+                                   double const cell, ptrdiff_t const lo,
+                                   ptrdiff_t const hi)
+{
+    double const coord = floor((x - x0) / cell);
+    
+    if (not (coord >= double(lo)))
+        return lo;
+    
+    if (coord >= double(hi))
+        return hi;
+    
+    return ptrdiff_t(coord);
+}
+
+
+static inline size_t grid_bucket(ptrdiff_t const cx, ptrdiff_t const cy,
+                                 size_t const mask)
+{
+    return (size_t(cx) * size_t(73856093) ^ size_t(cy) * size_t(19349663))
+           & mask;
+}
+
+
+// number of cells of size cell over span, 1 for a degenerate extent
+static inline ptrdiff_t grid_ncell(double const span, double const cell)
+{
+    double const ncell = floor(span / cell) + 1.0;
+    
+    return ncell < 1e18 ? ptrdiff_t(ncell) : 1;
+}
+
+
+/* Grid of the points of arr with cells of sqrt(max_sep) [deg], enlarged
+ * so that rounding cannot put two points that pass the distance test two
+ * cells apart. The error of a cell coordinate is a few ulp of its
+ * magnitude, which is at most the extent of the grid in cells, so the
+ * margin is relative to that. Points with NaN coordinates are left out,
+ * they are never close to anything. Returns true on (memory allocation)
+ * failure. */
+template<class Mat>
+static bool build_grid(Mat const& arr, double const max_sep, Pool& pool,
+                       point_grid& grid)
+{
+    size_t const num = arr.shape[0];
+    size_t nbucket = 1, nvalid = 0;
+    
+    // one bucket per point on average
+    while (nbucket < num)
+        nbucket *= 2;
+    
+    size_t *bucket;
+    
+    if ((grid.start = palloc(pool, size_t, nbucket + 1)) == NULL
+        or (bucket = palloc(pool, size_t, num)) == NULL
+        or (grid.lonlat = palloc(pool, double, 2 * num)) == NULL)
+        return true;
+    
+    grid.mask = nbucket - 1;
+    
+    double lon_max = 0.0, lat_max = 0.0;
+    grid.lon0 = grid.lat0 = 0.0;
+    
+    FOR(ii, num) {
+        double const lon = arr(ii, 0), lat = arr(ii, 1);
+        
+        if (lon != lon or lat != lat)
+            continue;
+        
+        if (nvalid++ == 0) {
+            grid.lon0 = lon_max = lon;
+            grid.lat0 = lat_max = lat;
+            continue;
+        }
+        
+        if (lon < grid.lon0) grid.lon0 = lon;
+        if (lon > lon_max)   lon_max = lon;
+        if (lat < grid.lat0) grid.lat0 = lat;
+        if (lat > lat_max)   lat_max = lat;
+    }
+    
+    double const cell = sqrt(max_sep),
+                 span_lon = lon_max - grid.lon0, span_lat = lat_max - grid.lat0,
+                 extent = (span_lon > span_lat ? span_lon : span_lat) / cell;
+    
+    grid.cell = cell * (1.0 + 4.0 * DBL_EPSILON * (extent + 2.0));
+    grid.nlon = grid_ncell(span_lon, grid.cell);
+    grid.nlat = grid_ncell(span_lat, grid.cell);
+    
+    FOR(ii, nbucket + 1)
+        grid.start[ii] = 0;
+    
+    FORZ(ii, num) {
+        double const lon = arr(ii, 0), lat = arr(ii, 1);
+        
+        if (lon != lon or lat != lat) {
+            bucket[ii] = nbucket;
+            continue;
+        }
+        
+        bucket[ii] = grid_bucket(
+                        grid_coord(lon, grid.lon0, grid.cell, 0, grid.nlon - 1),
+                        grid_coord(lat, grid.lat0, grid.cell, 0, grid.nlat - 1),
+                        grid.mask);
+        grid.start[bucket[ii] + 1]++;
+    }
+    
+    FOR1(ii, 1, nbucket + 1)
+        grid.start[ii] += grid.start[ii - 1];
+    
+    // counting sort by bucket, start[b] runs ahead and is shifted back
+    FORZ(ii, num) {
+        if (bucket[ii] == nbucket)
+            continue;
+        
+        size_t const row = grid.start[bucket[ii]]++;
+        
+        grid.lonlat[2 * row] = arr(ii, 0);
+        grid.lonlat[2 * row + 1] = arr(ii, 1);
+    }
+    
+    for(size_t ii = nbucket; ii > 0; --ii)
+        grid.start[ii] = grid.start[ii - 1];
+    
+    grid.start[0] = 0;
+    
+    return false;
+} // build_grid
+
+
+// points of arr1 that have a neighbour in the grid closer than max_sep,
+// the test is the one of the former scan over all points of arr2
+template<class Mat>
+static uint asc_dsc_select_loop(Mat const& arr1, point_grid const& grid,
+                                view<npy_bool>& idx, double const max_sep)
+{
+    npy_double dlon, dlat;
+    uint nfound = 0;
+    
+    FOR(ii, arr1.shape[0]) {
+        double const lon = arr1(ii,0), lat = arr1(ii,1);
+        
+        idx(ii) = NPY_FALSE;
+        
+        if (lon != lon or lat != lat)
+            continue;
+        
+        ptrdiff_t const
+            cx = grid_coord(lon, grid.lon0, grid.cell, -1, grid.nlon),
+            cy = grid_coord(lat, grid.lat0, grid.cell, -1, grid.nlat);
+        bool found = false;
+        
+        for(ptrdiff_t ix = cx - 1; ix <= cx + 1 and not found; ++ix) {
+            for(ptrdiff_t iy = cy - 1; iy <= cy + 1 and not found; ++iy) {
+                size_t const bb = grid_bucket(ix, iy, grid.mask);
+                
+                FOR1(jj, grid.start[bb], grid.start[bb + 1]) {
+                    dlon = lon - grid.lonlat[2 * jj];
+                    dlat = lat - grid.lonlat[2 * jj + 1];
+                    
+                    if ((dlon * dlon + dlat * dlat) < max_sep) {
+                        found = true;
+                        break;
+                    }
+                }
+            }
+        }
+        
+        if (found) {
+            idx(ii) = NPY_TRUE;
+            nfound++;
+        }
+    }
+    
+    return nfound;
+} // asc_dsc_select_loop
 
 
-pydoc(ell_to_merc, "ell_to_merc");
+pydoc(asc_dsc_select, "asc_dsc_select");
 
-static py_ptr ell_to_merc(py_varargs)
+static py_ptr asc_dsc_select(py_keywords)
 {
-    nparray _lon, _lat;
-    double a, e, lon0;
-    uint isdeg, fast;
-
-    parse_varargs("OOdddII", array_type(_lon), array_type(_lat), &lon0,
-                  &a, &e, &isdeg, &fast);
-
-    if (_lon.import(dt_double, 1) or _lat.import(dt_double, 1))
-        return NULL;
+    keywords("array1", "array2", "max_sep", "out");
     
-    size_t rows = _lon.shape[0];
-    if (_lat.check_rows(rows))
+    nparray _arr1, _arr2, _idx;
+    PyObject *out = NULL;
+    double max_sep = 100.0;
+    
+    parse_keywords("OO|dO:asc_dsc_select", array_type(_arr1),
+                   array_type(_arr2), &max_sep, &out);
+    
+    if (_arr1.import(real_type(_arr1), 2) or _arr2.import(real_type(_arr2), 2))
         return NULL;
     
-    nparray _xy;
+    if (_arr1.shape[1] < 2 or _arr2.shape[1] < 2) {
+        PyErr_Format(PyExc_ValueError, "array1 and array2 should have "
+                     "lon, lat columns!");
+        return NULL;
+    }
     
-    if (_xy.empty(dt_double, 0, npy_intp(rows), 2))
+    if (out == NULL or out == Py_None) {
+        if (_idx.empty(dt_bool, 0, 1, _arr1.shape[0]))
+            return NULL;
+    }
+    else if (_idx.import_out(dt_bool, 1, out)
+             or _idx.check_rows(_arr1.shape[0]))
         return NULL;
     
-    view<double> lon(_lon), lat(_lat), xy(_xy);
+    // nothing is closer than a non-positive (or NaN) separation, checked
+    // before squaring
+    bool const none = not (max_sep > 0.0);
     
-    if (isdeg) {
-        if (fast) {
-            FOR(ii, rows) {
-                xy(ii,0) = a * deg2rad * (lon(ii) - lon0);
-                
-                double scale = xy(ii,0) / lon(ii);
-                
-                xy(ii,1) = rad2deg * log(tan(pi_per_4 + lat(ii) * deg2rad / 2.0)) * scale;
-            }
-        } else {
-            FOR(ii, rows) {
-                xy(ii,0) = a * deg2rad * (lon(ii) - lon0);
-                
-                double sin_lat = sin(deg2rad * lat(ii));
-                double tmp = pow( (1 - e * sin_lat) / (1 + e * sin_lat) , e / 2.0);
-                
-                xy(ii,1) = a * (tan((pi_per_4 + lat(ii) / 2.0)) * tmp);
-            }
-        }
+    max_sep /=  R_earth;
+    max_sep = (max_sep * rad2deg) * (max_sep * rad2deg);
+    
+    uint nfound = 0;
+    
+    real_view arr1(_arr1), arr2(_arr2);
+    view<npy_bool> idx(_idx);
+    
+    size_t const n2 = arr2.shape[0];
+    
+    // one dispatch: float64 rows of unit stride, anything else
+    bool const fast = not arr1.is_float and not arr2.is_float
+                      and arr1.is_contiguous() and arr2.is_contiguous();
+    bool fail = false;
+    
+    Py_BEGIN_ALLOW_THREADS
+    // the square of a tiny separation may underflow to zero
+    if (none or not (max_sep > 0.0) or n2 == 0) {
+        FOR(ii, arr1.shape[0])
+            idx(ii) = NPY_FALSE;
     } else {
+        Pool pool(3, (2 * n2 + 1) * sizeof(size_t), n2 * sizeof(size_t),
+                  2 * n2 * sizeof(double));
+        point_grid grid;
+        
         if (fast) {
-            FOR(ii, rows) {
-                xy(ii,0) = a * (lon(ii) - lon0);
-                
-                double scale = xy(ii,0) / lon(ii);
-                
-                xy(ii,1) = rad2deg * log(tan(pi_per_4 + lat(ii) / 2.0)) * scale;
-            }
+            fview<double, 2, contiguous> const a1(arr1.dbl), a2(arr2.dbl);
+            
+            fail = pool.init() or build_grid(a2, max_sep, pool, grid);
+            
+            if (not fail)
+                nfound = asc_dsc_select_loop(a1, grid, idx, max_sep);
         } else {
-            FOR(ii, rows) {
-                xy(ii,0) = a * (lon(ii) - lon0);
-                
-                double sin_lat = sin(lat(ii));
-                double tmp = pow( (1 - e * sin_lat) / (1 + e * sin_lat) , e / 2.0);
-                
-                xy(ii,1) = a * (tan((pi_per_4 + lat(ii) / 2.0)) * tmp);
-            }
+            fail = pool.init() or build_grid(arr2, max_sep, pool, grid);
+            
+            if (not fail)
+                nfound = asc_dsc_select_loop(arr1, grid, idx, max_sep);
         }
     }
+    Py_END_ALLOW_THREADS
     
-    return Py_BuildValue("N", _xy.ret());
-}
+    if (fail)
+        return PyErr_NoMemory();
+    
+    return Py_BuildValue("NI", _idx.ret(), nfound);
+} // asc_dsc_select
 
 
-pydoc(test, "test");
+// columns of the input rows of dominant, as in the .xys files of DAISY
+enum xys_column { xys_lon, xys_lat, xys_v, xys_h, xys_dh, xys_ncols };
 
-static py_ptr test(py_varargs)
+// columns of the dominant points, as in dominant.xyd of DAISY
+enum xyd_column { xyd_lon, xyd_lat, xyd_h, xyd_asc_v, xyd_dsc_v, xyd_ncols };
+
+
+/* Adds the free points of data (from row first on) closer than max_sep to
+ * lon, lat to the cluster: they are marked selected, their WGS-84
+ * Cartesian coordinates and velocity are appended to members (x, y, z, v
+ * per point). The cluster step of daisy.c. Returns true on (memory
+ * allocation) failure. */
+static bool cluster_track(view<npy_double> const& data, size_t const first,
+                          array<bool>& selected, double const lon,
+                          double const lat, double const max_sep,
+                          vector<double>& members)
 {
-    nparray _arr;
-    parse_varargs("O", array_type(_arr));
+    FOR1(ii, first, data.shape[0]) {
+        if (selected[ii])
+            continue;
+        
+        double const dlon = data(ii, xys_lon) - lon,
+                     dlat = data(ii, xys_lat) - lat;
+        
+        if (not (dlon * dlon + dlat * dlat < max_sep))
+            continue;
+        
+        double *mem;
+        
+        if ((mem = members.extend(4)) == NULL)
+            return true;
+        
+        selected[ii] = true;
+        
+        ell_cart(data(ii, xys_lon) * deg2rad, data(ii, xys_lat) * deg2rad,
+                 data(ii, xys_h) + data(ii, xys_dh), mem[0], mem[1], mem[2]);
+        mem[3] = data(ii, xys_v);
+    }
+    
+    return false;
+} // cluster_track
 
-    if (_arr.import(dt_double, 1))
+
+/* Velocity of the members of one track at xyz, inverse distance squared
+ * weighted as in estim_dominant of daisy.c. Members at xyz would get an
+ * infinite weight; if there are any, the mean of their velocities is
+ * taken (the limit of the weighting). */
+static double idw_velocity(vector<double> const& members, double const xyz[3])
+{
+    double sumw = 0.0, sumwv = 0.0, sumv0 = 0.0;
+    size_t n0 = 0;
+    
+    FORS(ii, 0, members.size, 4) {
+        double const dx = xyz[0] - members[ii], dy = xyz[1] - members[ii + 1],
+                     dz = xyz[2] - members[ii + 2],
+                     dist = sqrt(dx * dx + dy * dy + dz * dz);
+        
+        if (dist == 0.0) {
+            sumv0 += members[ii + 3];
+            n0++;
+            continue;
+        }
+        
+        sumw += 1.0 / dist / dist;
+        sumwv += members[ii + 3] / dist / dist;
+    }
+    
+    return n0 > 0 ? sumv0 / double(n0) : sumwv / sumw;
+}
+
+
+/* DAISY dominant step, a port of dominant, cluster and estim_dominant of
+ * daisy.c. Clusters are seeded by the ascending points not in a cluster
+ * yet, in order; a cluster takes the free points of both tracks closer
+ * than max_sep [deg^2] to its seed. Descending points are never seeds,
+ * those not near any ascending point stay unclustered. A cluster with
+ * points of both tracks gives a row of clustered (xyd_column): lon [deg],
+ * lat [deg] and h of the dominant point, the velocity of the ascending,
+ * then of the descending track there. The dominant point is
+ * the Cartesian mean of the two tracks, each with a weight of 1/2,
+ * converted back by cart_ell (lon in [-90, 270) deg); the velocities are
+ * interpolated to it by idw_velocity. Clusters of ascending points only
+ * are hermits and are dropped. Ascending points with NaN lon or lat seed
+ * nothing. Returns true on (memory allocation) failure. */
+static bool cluster_dominant(view<npy_double> const& asc,
+                             view<npy_double> const& dsc, double const max_sep,
+                             vector<double>& clustered, uint& ncluster,
+                             uint& nhermite)
+{
+    size_t const nasc = asc.shape[0], ndsc = dsc.shape[0];
+    
+    array<bool> asc_selected, dsc_selected;
+    vector<double> asc_members, dsc_members;
+    
+    if (asc_selected.zeros(nasc) or dsc_selected.zeros(ndsc))
+        return true;
+    
+    FORZ(kk, nasc) {
+        if (asc_selected[kk])
+            continue;
+        
+        double const lon = asc(kk, xys_lon), lat = asc(kk, xys_lat);
+        
+        asc_members.clear();
+        dsc_members.clear();
+        
+        // rows before kk are all in clusters already
+        if (cluster_track(asc, kk, asc_selected, lon, lat, max_sep,
+                          asc_members)
+            or cluster_track(dsc, 0, dsc_selected, lon, lat, max_sep,
+                             dsc_members))
+            return true;
+        
+        size_t const na = asc_members.size / 4, nd = dsc_members.size / 4;
+        
+        if (na == 0)
+            continue;
+        
+        if (nd == 0) {
+            nhermite++;
+            continue;
+        }
+        
+        // sum of the weights 1 / na and 1 / nd is 2
+        double xyz[3] = {0.0, 0.0, 0.0}, *row;
+        
+        FORS(ii, 0, asc_members.size, 4) {
+            FOR(jj, 3)
+                xyz[jj] += asc_members[ii + jj] / double(na);
+        }
+        
+        FORS(ii, 0, dsc_members.size, 4) {
+            FOR(jj, 3)
+                xyz[jj] += dsc_members[ii + jj] / double(nd);
+        }
+        
+        FOR(jj, 3)
+            xyz[jj] /= 2.0;
+        
+        if ((row = clustered.extend(xyd_ncols)) == NULL)
+            return true;
+        
+        cart_ell(xyz[0], xyz[1], xyz[2], row[xyd_lon], row[xyd_lat],
+                 row[xyd_h]);
+        
+        row[xyd_lon] *= rad2deg;
+        row[xyd_lat] *= rad2deg;
+        row[xyd_asc_v] = idw_velocity(asc_members, xyz);
+        row[xyd_dsc_v] = idw_velocity(dsc_members, xyz);
+        
+        ncluster++;
+    }
+    
+    return false;
+} // cluster_dominant
+
+
+pydoc(dominant, "dominant");
+
+static py_ptr dominant(py_keywords)
+{
+    keywords("asc_data", "dsc_data", "cluster_sep");
+    
+    nparray _asc, _dsc, _clustered;
+    double max_sep = 100.0;
+    
+    parse_keywords("OO|d:dominant", array_type(_asc), array_type(_dsc), &max_sep);
+    
+    // rows of lon, lat, v, h, dh
+    if (_asc.import(dt_double, 2) or _asc.check_cols(xys_ncols)
+        or _dsc.import(dt_double, 2) or _dsc.check_cols(xys_ncols))
         return NULL;
     
-    view<npy_double> arr(_arr);
+    // the separation of asc_dsc_select; nothing is closer than a
+    // non-positive (or NaN) separation, checked before squaring
+    bool const none = not (max_sep > 0.0);
     
-    FORZ(ii, arr.shape[0])
-        printf("%lf ", arr(ii));
+    max_sep /=  R_earth;
+    max_sep = (max_sep * rad2deg) * (max_sep * rad2deg);
+    
+    uint ncluster = 0, nhermite = 0;
+    
+    view<npy_double> asc(_asc), dsc(_dsc);
+    vector<double> clustered;
+    bool fail = false;
+    
+    Py_BEGIN_ALLOW_THREADS
+    if (not none)
+        fail = cluster_dominant(asc, dsc, max_sep, clustered, ncluster,
+                                nhermite);
+    Py_END_ALLOW_THREADS
+    
+    if (fail)
+        return PyErr_NoMemory();
+    
+    if (_clustered.adopt(dt_double, clustered, xyd_ncols))
+        return NULL;
+    
+    return Py_BuildValue("NII", _clustered.ret(), ncluster, nhermite);
+} // dominant
 
-    printf("\n");
 
-    Py_RETURN_NONE;
+/****************
+ * Orbit object *
+ ****************/
+
+/* inmet_aux.Orbit: an orbit polynom copied (or fitted, or read) once into
+ * a sat_orbit, its methods only import the points and run the kernels. */
+struct orbit_object {
+    PyObject_HEAD
+    sat_orbit *orb;
+};
+
+// zero initialized, the header and the slots are set in module init
+static PyTypeObject orbit_type;
+
+
+static orbit_object * orbit_alloc(PyTypeObject *type)
+{
+    orbit_object *self = (orbit_object*) type->tp_alloc(type, 0);
+    
+    if (self == NULL)
+        return NULL;
+    
+    if ((self->orb = new sat_orbit) == NULL) {
+        Py_DECREF(self);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    
+    return self;
 }
 
 
-pydoc(azi_inc, "azi_inc");
+static void orbit_dealloc(orbit_object *self)
+{
+    delete self->orb;
+    Py_TYPE(self)->tp_free((PyObject*) self);
+}
 
-static py_ptr azi_inc(py_varargs)
+
+static py_ptr orbit_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
 {
-    double mean_t = 0.0, start_t = 0.0, stop_t = 0.0;
-    uint is_centered = 0, deg = 0, is_lonlat = 0, max_iter = 0;
+    keywords("mean_t", "start_t", "stop_t", "is_centered", "deg",
+             "mean_coords", "coeffs", "basis");
+    
+    double mean_t = 0.0, start_t = 0.0, stop_t = 0.0, mean_coords[3];
+    uint is_centered = 0, deg = 0, basis = basis_power;
     
-    nparray _mean_coords, _coeffs, _coords, _azi_inc;
+    nparray _mean_coords, _coeffs;
     
-    parse_varargs("dddIIOOOII", &mean_t, &start_t, &stop_t, &is_centered,
-                  &deg, array_type(_mean_coords), array_type(_mean_coords),
-                  array_type(_coords), &is_lonlat, &max_iter);
+    parse_keywords("dddIIOO|I:Orbit", &mean_t, &start_t, &stop_t,
+                   &is_centered, &deg, array_type(_mean_coords),
+                   array_type(_coeffs), &basis);
     
-    if (_mean_coords.import(dt_double, 1) or _coeffs.import(dt_double, 2)
-        or _coords.import(dt_double, 2))
+    if (check_basis(basis, deg, start_t, stop_t))
         return NULL;
     
-    if (_azi_inc.empty(dt_double, 0, npy_intp(_coords.shape[0]), 2))
+    if (import_mean_coords(_mean_coords, mean_coords)
+        or import_coeffs(_coeffs, deg))
         return NULL;
     
-    view<npy_double> coeffs(_coeffs), coords(_coords), azi_inc(_azi_inc);
+    view<npy_double> coeffs(_coeffs);
+    orbit_object *self = orbit_alloc(type);
     
-    // Set up orbit polynomial structure
-    fit_poly orb(mean_t, start_t, stop_t,
-                (npy_double*) _mean_coords.data(), coeffs, is_centered,
-                deg);
+    if (self == NULL)
+        return NULL;
     
-    calc_azi_inc(orb, coords, azi_inc, max_iter, is_lonlat);
+    if (self->orb->init(mean_t, start_t, stop_t, mean_coords, coeffs,
+                        is_centered, deg, poly_basis(basis))) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
     
-    return Py_BuildValue("N", _azi_inc.ret());
-} // azi_inc
+    return (py_ptr) self;
+} // orbit_new
 
 
-pydoc(asc_dsc_select, "asc_dsc_select");
+pydoc(from_fit_file, "from_fit_file");
 
-static py_ptr asc_dsc_select(py_keywords)
+static py_ptr from_fit_file(PyObject *cls, PyObject *args)
 {
-    keywords("array1", "array2", "max_sep");
+    char const *path = NULL;
     
-    nparray _arr1, _arr2, _idx;
-    double max_sep = 100.0;
+    parse_varargs("s:from_fit_file", &path);
     
-    parse_keywords("OO|d:asc_dsc_select", array_type(_arr1), array_type(_arr2),
-                                          &max_sep);
+    orbit_object *self = orbit_alloc((PyTypeObject*) cls);
     
-    if (_arr1.import(dt_double, 2) or _arr2.import(dt_double, 2))
+    if (self == NULL)
         return NULL;
     
-    if (_idx.zeros(dt_double, 0, _arr1.shape[0]))
-        return NULL;
+    fit_poly const& fit = self->orb->fit;
     
-    max_sep /=  R_earth;
-    max_sep = (max_sep * rad2deg) * (max_sep * rad2deg);
+    fit_read_status const status = self->orb->read(path);
     
-    npy_double dlon, dlat;
-    uint nfound = 0;
+    // before Py_DECREF, which may change errno
+    if (status == fit_read_io)
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+    else if (status == fit_read_no_memory)
+        PyErr_NoMemory();
+    else if (status != fit_read_ok)
+        PyErr_Format(PyExc_ValueError, "Failed to load the orbit of \"%s\": "
+                     "%s!", path, fit_read_message(status));
     
-    view<npy_double> arr1(_arr1), arr2(_arr2);
-    view<npy_bool> idx(_idx);
+    if (status != fit_read_ok) {
+        Py_DECREF(self);
+        return NULL;
+    }
     
-    FOR(ii, arr1.shape[0]) {
-        FOR(jj, arr2.shape[0]) {
-            dlon = arr1(ii,0) - arr2(jj,0);
-            dlat = arr1(ii,1) - arr2(jj,1);
-            
-            if ((dlon * dlon + dlat * dlat) < max_sep) {
-                idx(ii) = NPY_TRUE;
-                nfound++;
-                break;
-            }
-        }
+    if (check_basis(fit.basis, uint(fit.deg), fit.start_t, fit.stop_t)) {
+        Py_DECREF(self);
+        return NULL;
     }
     
-    return Py_BuildValue("NI", _idx.ret(), nfound);
-} // asc_dsc_select
+    return (py_ptr) self;
+} // from_fit_file
 
 
-pydoc(dominant, "dominant");
+pydoc(from_state_vectors, "from_state_vectors");
 
-static py_ptr dominant(py_keywords)
+static py_ptr from_state_vectors(PyObject *cls, PyObject *args,
+                                 PyObject *kwargs)
 {
-    keywords("asc_data", "dsc_data", "cluster_sep");
+    keywords("time", "coords", "deg", "is_centered", "basis");
     
-    nparray _asc, _dsc;
-    double max_sep = 100.0;
+    uint deg = 3, is_centered = 1, basis = basis_power;
+    nparray _time, _coords;
     
-    parse_keywords("OO|d:dominant", array_type(_asc), array_type(_dsc), &max_sep);
+    parse_keywords("OO|III:from_state_vectors", array_type(_time),
+                   array_type(_coords), &deg, &is_centered, &basis);
     
-    if (_asc.import(dt_double, 2) or _dsc.import(dt_double, 2))
+    if (_time.import(dt_double, 1) or _coords.import(dt_double, 2)
+        or _coords.check_rows(_time.shape[0]) or _coords.check_cols(3))
         return NULL;
     
-    uint ncluster = 0, nhermite = 0;
+    if (deg == 0 or _time.shape[0] <= deg) {
+        PyErr_Format(PyExc_ValueError, "deg should be positive and less "
+                     "than the number of state vectors (%u) not %u!",
+                     uint(_time.shape[0]), deg);
+        return NULL;
+    }
     
-    array<bool> asc_selected, dsc_selected;
+    view<npy_double> time(_time), coords(_coords);
+    double start_t = time(0), stop_t = time(0);
+    
+    FOR(ii, _time.shape[0]) {
+        if (time(ii) < start_t) start_t = time(ii);
+        if (time(ii) > stop_t) stop_t = time(ii);
+    }
     
-    if (asc_selected.init(_asc.shape[0]) or dsc_selected.init(_dsc.shape[0]))
+    if (check_basis(basis, deg, start_t, stop_t))
         return NULL;
     
-    //vector<double> clustered;
+    orbit_object *self = orbit_alloc((PyTypeObject*) cls);
+    bool fail;
     
-    //return Py_BuildValue("NII", ret(clustered), ncluster, nhermite);
-    Py_RETURN_NONE;
-} // dominant
+    if (self == NULL)
+        return NULL;
+    
+    Py_BEGIN_ALLOW_THREADS
+    fail = self->orb->fit_state(time, coords, deg, is_centered,
+                                poly_basis(basis));
+    Py_END_ALLOW_THREADS
+    
+    if (fail) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    
+    return (py_ptr) self;
+} // from_state_vectors
+
+
+// positions or velocities of the orbit at time
+static py_ptr orbit_state(orbit_object *self, PyObject *args,
+                          PyObject *kwargs, bool const is_vel)
+{
+    keywords("time", "out");
+    
+    nparray _time, _state;
+    PyObject *out = NULL;
+    
+    parse_keywords(is_vel ? "O|O:velocity" : "O|O:position",
+                   array_type(_time), &out);
+    
+    if (_time.import(dt_double, 1)
+        or output_array(_state, out, _time.shape[0], 3))
+        return NULL;
+    
+    view<npy_double> time(_time), state(_state);
+    
+    Py_BEGIN_ALLOW_THREADS
+    calc_orbit_state(self->orb->fit, time, is_vel ? NULL : &state,
+                     is_vel ? &state : NULL);
+    Py_END_ALLOW_THREADS
+    
+    return Py_BuildValue("N", _state.ret());
+}
+
+
+pydoc(position, "position");
+
+static py_ptr position(orbit_object *self, PyObject *args, PyObject *kwargs)
+{
+    return orbit_state(self, args, kwargs, false);
+}
+
+
+pydoc(velocity, "velocity");
+
+static py_ptr velocity(orbit_object *self, PyObject *args, PyObject *kwargs)
+{
+    return orbit_state(self, args, kwargs, true);
+}
+
+
+pydoc(orbit_azi_inc, "azi_inc");
+
+static py_ptr orbit_azi_inc(orbit_object *self, PyObject *args,
+                            PyObject *kwargs)
+{
+    keywords("coords", "is_lonlat", "max_iter", "solver", "return_niter",
+             "warm_start", "nthreads", "lut_step", "fast_math", "output",
+             "sar", "float32", "out");
+    
+    azi_inc_args arg;
+    
+    parse_keywords("O|IIIIII(ddd)II(dddd)IO:azi_inc",
+                   array_type(arg._coords), &arg.is_lonlat, &arg.max_iter,
+                   &arg.solver, &arg.return_niter, &arg.warm_start,
+                   &arg.nthreads, &arg.lut.dlon, &arg.lut.dlat, &arg.lut.dh,
+                   &arg.fast_math, &arg.output, &arg.sar.t_first,
+                   &arg.sar.prf, &arg.sar.near_range, &arg.sar.rsr,
+                   &arg.float32, &arg.out);
+    
+    return run_azi_inc(self->orb->fit, arg);
+}
+
+
+pydoc(zero_doppler, "zero_doppler");
+
+static py_ptr zero_doppler(orbit_object *self, PyObject *args,
+                           PyObject *kwargs)
+{
+    keywords("coords", "is_lonlat", "max_iter", "solver", "warm_start",
+             "nthreads", "fast_math", "out");
+    
+    azi_inc_args arg;
+    
+    parse_keywords("O|IIIIIIO:zero_doppler", array_type(arg._coords),
+                   &arg.is_lonlat, &arg.max_iter, &arg.solver,
+                   &arg.warm_start, &arg.nthreads, &arg.fast_math, &arg.out);
+    
+    arg.output = go_radar;
+    
+    return run_azi_inc(self->orb->fit, arg);
+}
+
+
+// fields of fit_poly exposed as read-only attributes
+enum orbit_field {
+    of_mean_t, of_start_t, of_stop_t, of_deg, of_is_centered, of_basis
+};
+
+static py_ptr orbit_get(orbit_object *self, void *closure)
+{
+    fit_poly const& fit = self->orb->fit;
+    
+    switch (orbit_field(size_t(closure))) {
+        case of_mean_t:
+            return PyFloat_FromDouble(fit.mean_t);
+        case of_start_t:
+            return PyFloat_FromDouble(fit.start_t);
+        case of_stop_t:
+            return PyFloat_FromDouble(fit.stop_t);
+        case of_deg:
+            return PyLong_FromSize_t(fit.deg);
+        case of_is_centered:
+            return PyLong_FromSize_t(fit.is_centered);
+        default:
+            return PyLong_FromLong(long(fit.basis));
+    }
+}
+
+
+// copies of the coefficients (3, deg + 1) and mean_coords (3)
+static py_ptr orbit_get_array(orbit_object *self, void *closure)
+{
+    sat_orbit const& orb = *self->orb;
+    bool const is_coeffs = closure != NULL;
+    nparray arr;
+    
+    if (is_coeffs ? arr.empty(dt_double, 0, 2, size_t(3), orb.fit.deg + 1)
+                  : arr.empty(dt_double, 0, 1, size_t(3)))
+        return NULL;
+    
+    view<npy_double> out(arr);
+    
+    FOR(jj, 3) {
+        if (not is_coeffs)
+            out(jj) = orb.mean_coords[jj];
+        else {
+            FOR(ii, orb.fit.deg + 1)
+                out(jj, ii) = orb.coeffs(jj, ii);
+        }
+    }
+    
+    return Py_BuildValue("N", arr.ret());
+}
+
+
+#define orbit_getter(name, field) \
+{(char*) name, (getter) orbit_get, NULL, NULL, (void*) of_ ## field}
+
+static PyGetSetDef orbit_getset[] = {
+    orbit_getter("mean_t", mean_t),
+    orbit_getter("start_t", start_t),
+    orbit_getter("stop_t", stop_t),
+    orbit_getter("deg", deg),
+    orbit_getter("is_centered", is_centered),
+    orbit_getter("basis", basis),
+    {(char*) "mean_coords", (getter) orbit_get_array, NULL, NULL, NULL},
+    {(char*) "coeffs", (getter) orbit_get_array, NULL, NULL, (void*) 1},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyMethodDef orbit_methods[] = {
+    {"from_fit_file", (PyCFunction) from_fit_file, METH_VARARGS | METH_CLASS,
+     from_fit_file__doc__},
+    {"from_state_vectors", (PyCFunction) from_state_vectors,
+     METH_VARARGS | METH_KEYWORDS | METH_CLASS, from_state_vectors__doc__},
+    {"azi_inc", (PyCFunction) orbit_azi_inc, METH_VARARGS | METH_KEYWORDS,
+     orbit_azi_inc__doc__},
+    pymeth_keywords(position),
+    pymeth_keywords(velocity),
+    pymeth_keywords(zero_doppler),
+    {NULL, NULL, 0, NULL}
+};
+
+
+// messages of the core library go to sys.stdout / sys.stderr, they may
+// come from threads not holding the GIL
+static void py_log(bool const is_error, char const* msg)
+{
+    PyGILState_STATE gil = PyGILState_Ensure();
+    
+    if (is_error)
+        PySys_WriteStderr("%s", msg);
+    else
+        PySys_WriteStdout("%s", msg);
+    
+    PyGILState_Release(gil);
+}
 
 
 //------------------------------------------------------------------------------
@@ -212,9 +1629,14 @@ static py_ptr dominant(py_keywords)
 static char const* module_doc = "inmet_aux";
 
 static PyMethodDef module_methods[] = {
-    pymeth_varargs(ell_to_merc),
+    pymeth_keywords(ell_to_merc),
     pymeth_varargs(test),
-    pymeth_varargs(azi_inc),
+    pymeth_keywords(azi_inc),
+    pymeth_keywords(azi_inc_multi),
+    pymeth_keywords(azi_inc_file),
+    pymeth_keywords(geocode),
+    pymeth_keywords(ell_to_cart),
+    pymeth_keywords(cart_to_ell),
     pymeth_keywords(asc_dsc_select),
     pymeth_keywords(dominant),
     {NULL, NULL, 0, NULL}
@@ -259,6 +1681,29 @@ PyMODINIT_FUNC CONCAT(init, inmet_aux)(void) {
                         module_name " (failed to import numpy)");
         return RETVAL;
     }
+    
+    set_log_handler(py_log);
+    
+    // what PyVarObject_HEAD_INIT(&PyType_Type, 0) would set
+    Py_SET_REFCNT(&orbit_type, 1);
+    Py_SET_TYPE(&orbit_type, &PyType_Type);
+    
+    orbit_type.tp_name = module_name ".Orbit";
+    orbit_type.tp_basicsize = sizeof(orbit_object);
+    orbit_type.tp_dealloc = (destructor) orbit_dealloc;
+    orbit_type.tp_flags = Py_TPFLAGS_DEFAULT;
+    orbit_type.tp_doc = "Orbit(mean_t, start_t, stop_t, is_centered, deg, "
+                        "mean_coords, coeffs, basis=0)";
+    orbit_type.tp_methods = orbit_methods;
+    orbit_type.tp_getset = orbit_getset;
+    orbit_type.tp_new = orbit_new;
+    
+    if (PyType_Ready(&orbit_type) < 0)
+        return RETVAL;
+    
+    Py_INCREF(&orbit_type);
+    PyModule_AddObject(m, "Orbit", (PyObject*) &orbit_type);
+    
     d = PyModule_GetDict(m);
     s = PyString_FromString("$Revision: $");
     
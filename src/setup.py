@@ -18,9 +18,12 @@ from numpy.distutils.core import Extension, setup
 
 
 def main():
-    #flags = ["-std=c++03", "-O3", "-march=native", "-ffast-math", "-funroll-loops"]
+    # -ffp-contract=off keeps the SIMD lanes of calc_azi_inc bit identical
+    # to the scalar code path; add -march=native (or -mavx2, -mavx512f)
+    # to enable the vectorized kernels.
+    #flags = ["-std=c++03", "-O3", "-march=native", "-ffp-contract=off", "-funroll-loops"]
     #flags = ["-std=c++03", "-O0", "-save-temps"]
-    flags = ["-std=c++98", "-O0"]
+    flags = ["-std=c++98", "-O0", "-ffp-contract=off"]
     macros = [("NPY_NO_DEPRECATED_API", "NPY_1_7_API_VERSION")]
     inc_dirs = ["/home/istvan/miniconda3/include", "include"]
     lib_dirs = ["/home/istvan/miniconda3/lib"]
@@ -28,19 +31,33 @@ def main():
     satorbit = join("aux", "satorbit.cc")
     utils = join("aux", "utils.cc")
     nparray = join("aux", "nparray.cc")
+    parallel = join("aux", "parallel.cc")
+    stream = join("aux", "stream.cc")
     
-    sources = ["inmet_auxmodule.cc", satorbit, utils, nparray, "tpl_spec.cc"]
+    # numeric core, does not include Python.h (cli/compile.py links the
+    # same sources into the inmet_azi_inc executable)
+    core = [satorbit, utils, parallel, stream, "tpl_spec.cc"]
+    
+    libraries = [
+        ("inmet_core", dict(sources=core, include_dirs=["include"],
+                            extra_compiler_args=flags + ["-fPIC",
+                                                         "-pthread"]))
+    ]
+    
+    # thin binding layer
+    sources = ["inmet_auxmodule.cc", nparray]
     
     ext_modules = [
         Extension(name="inmet_aux", sources=sources,
                   define_macros=macros,
-                  extra_compile_args=flags,
+                  extra_compile_args=flags + ["-pthread"],
+                  extra_link_args=["-pthread"],
                   library_dirs=lib_dirs,
-                  libraries=["m"],
+                  libraries=["inmet_core", "m", "pthread"],
                   include_dirs=inc_dirs)
     ]
     
-    setup(ext_modules=ext_modules)
+    setup(libraries=libraries, ext_modules=ext_modules)
 
 if __name__ == "__main__":
     main()
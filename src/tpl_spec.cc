@@ -1,10 +1,15 @@
-//#include "pyvector.hh"
-#include "array.hh"
-
+// explicit instantiations need the definitions of array.hh and vector.hh
 #define __INMET_IMPL
 
-//template struct vector<double>;
+#include "array.hh"
+#include "vector.hh"
 
 template struct array<bool>;
+template struct array<float>;
+template struct array<double>;
+
+template struct vector<double>;
+template struct vector<size_t>;
+template struct soa_vector<double>;
 
 #undef __INMET_IMPL